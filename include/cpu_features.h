@@ -0,0 +1,11 @@
+#ifndef MSEXECRC_CPU_FEATURES_HDR
+#define MSEXECRC_CPU_FEATURES_HDR
+
+// Whether the running CPU has AVX2, which the summing and scanning kernels
+// dispatch on. Checked once.
+bool cpu_has_avx2();
+
+// The kernel those modules run, "avx2" or "scalar".
+const char* avx2_kernel_name();
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef MSEXECRC_CRC32_HDR
+#define MSEXECRC_CRC32_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Table driven CRC32 kernels for reflected (LSB first) generators.
+// All kernels take and return the raw CRC register, so callers are
+// responsible for the initial value and the final inversion.
+
+enum class crc_kernel {
+    automatic,
+    bytewise,
+    slice8,
+    slice16,
+    clmul,
+    lanes,
+};
+
+// Number of 256 entry tables needed by the widest kernel.
+#define CRC32_NUM_TABLES 16
+
+// Folding and Barrett reduction constants for the carry-less multiply kernel.
+// Each k is (x^n mod P)' << 1 where ' is 32 bit reflection, mu is (x^64 / P)'
+// and poly is P' over 33 bits.
+struct crc32_fold_constants {
+    uint64_t k1; // n = 4*128+32
+    uint64_t k2; // n = 4*128-32
+    uint64_t k3; // n = 128+32
+    uint64_t k4; // n = 128-32
+    uint64_t k5; // n = 64
+    uint64_t poly;
+    uint64_t mu;
+};
+
+struct crc32_tables {
+    uint32_t generator;
+    uint32_t t[CRC32_NUM_TABLES][256];
+    crc32_fold_constants fold;
+};
+
+constexpr uint32_t crc32_reflect32(uint32_t v) {
+    uint32_t r = 0;
+    for(int i = 0; i < 32; ++i) {
+        if(v & (1U << i)) {
+            r |= 1U << (31-i);
+        }
+    }
+    return r;
+}
+
+// x^n mod P in normal bit order, P given with its x^32 term.
+constexpr uint32_t crc32_xpow_mod(unsigned n, uint64_t poly) {
+    uint64_t rem = 1;
+    for(unsigned i = 0; i < n; ++i) {
+        rem <<= 1;
+        if(rem & (1ULL << 32)) {
+            rem ^= poly;
+        }
+    }
+    return (uint32_t)rem;
+}
+
+// Derive the folding constants from the generator, see crc32_fold_constants.
+constexpr crc32_fold_constants crc32_make_fold_constants(uint32_t generator) {
+    crc32_fold_constants fold = {};
+    uint64_t poly = (1ULL << 32)|crc32_reflect32(generator);
+
+    fold.k1 = ((uint64_t)crc32_reflect32(crc32_xpow_mod(4*128+32, poly))) << 1;
+    fold.k2 = ((uint64_t)crc32_reflect32(crc32_xpow_mod(4*128-32, poly))) << 1;
+    fold.k3 = ((uint64_t)crc32_reflect32(crc32_xpow_mod(128+32, poly))) << 1;
+    fold.k4 = ((uint64_t)crc32_reflect32(crc32_xpow_mod(128-32, poly))) << 1;
+    fold.k5 = ((uint64_t)crc32_reflect32(crc32_xpow_mod(64, poly))) << 1;
+
+    // Quotient of x^64 / P by long division, it has degree 32.
+    uint64_t quot = 0;
+    uint64_t rem = 1ULL << 32;
+    for(int i = 32; i >= 0; --i) {
+        if(rem & (1ULL << 32)) {
+            quot |= 1ULL << i;
+            rem ^= poly;
+        }
+        rem <<= 1;
+    }
+
+    // Reflect the 33 bit values.
+    fold.mu = (((uint64_t)crc32_reflect32((uint32_t)quot)) << 1)|(quot >> 32);
+    fold.poly = (((uint64_t)generator) << 1)|1;
+    return fold;
+}
+
+// Build all slicing tables and fold constants for a reflected generator.
+// Usable at compile time, see crc32_static_tables.
+constexpr crc32_tables crc32_make_tables(uint32_t generator) {
+    crc32_tables tables = {};
+    tables.generator = generator;
+
+    /* Calculate the base CRC table. */
+    for(int i = 0; i < 256; i++) {
+        uint32_t rem = i; /* remainder from polynomial division */
+        for(int j = 0; j < 8; ++j) {
+            if(rem & 1) {
+                rem >>= 1;
+                rem ^= generator;
+            } else {
+                rem >>= 1;
+            }
+        }
+        tables.t[0][i] = rem;
+    }
+
+    // Table k advances a byte through k further zero bytes.
+    for(int k = 1; k < CRC32_NUM_TABLES; ++k) {
+        for(int i = 0; i < 256; ++i) {
+            uint32_t prev = tables.t[k-1][i];
+            tables.t[k][i] = (prev >> 8) ^ tables.t[0][prev & 0xff];
+        }
+    }
+
+    tables.fold = crc32_make_fold_constants(generator);
+    return tables;
+}
+
+// Tables for a generator known at compile time.
+template<uint32_t Generator>
+struct crc32_static_tables {
+    static constexpr crc32_tables value = crc32_make_tables(Generator);
+};
+
+// Runtime version of crc32_make_tables.
+void crc32_build_tables(uint32_t generator, crc32_tables& tables);
+
+// Tables for any generator. The generators in the default sweep come from
+// crc32_static_tables, others are built on first use and cached for the
+// lifetime of the process. Safe to call from several threads.
+const crc32_tables& crc32_get_tables(uint32_t generator);
+
+uint32_t crc32_update_bytewise(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+uint32_t crc32_update_slice16(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+// Only valid when crc32_have_clmul() is true.
+uint32_t crc32_update_clmul(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+
+// Whether this CPU supports the carry-less multiply kernel.
+bool crc32_have_clmul();
+
+// Resolve crc_kernel::automatic, and SIMD kernels on CPUs without them, to a kernel which can run here.
+crc_kernel crc32_resolve_kernel(crc_kernel kernel);
+
+typedef uint32_t (*crc32_update_fn)(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+
+// Pick the update function for a kernel and generator. For generators with
+// static tables the table kernels are specialized on the generator, so the
+// table addresses are link time constants.
+crc32_update_fn crc32_select_update(crc_kernel kernel, uint32_t generator);
+
+// Dispatch to the requested kernel, falling back to slice16 when clmul isn't available.
+// The lanes kernel only applies to crc32_update_lanes, single streams use the automatic choice.
+uint32_t crc32_update(crc_kernel kernel, uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables);
+
+// Linear operator on the raw CRC register as a 32x32 matrix over GF(2),
+// col[i] is the image of bit i.
+struct crc32_matrix {
+    uint32_t col[32];
+};
+
+uint32_t crc32_matrix_apply(const crc32_matrix& m, uint32_t v);
+
+// Advance a raw CRC register over len zero bytes. Uses cached powers of the
+// one byte operator, so it costs O(log len) matrix-vector products.
+uint32_t crc32_shift(uint32_t crc, uint64_t len, uint32_t generator);
+
+// CRC of A followed by B, given the CRCs of A and of B and the length of B.
+// Works for finalized CRCs whose initial value equals the final xor, such as
+// the ~0 used throughout, and for raw registers started from zero.
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b, uint32_t generator);
+
+// Whether the generator's polynomial has an x^0 term, which makes stepping
+// the register over zeros invertible. Needed by crc32_unshift and crc32_force.
+bool crc32_invertible(uint32_t generator);
+
+// Undo crc32_shift: the register that len zero bytes advance to crc.
+uint32_t crc32_unshift(uint32_t crc, uint64_t len, uint32_t generator);
+
+// The 4 bytes that take the raw register from 'from' to 'to', found with
+// the inverse of the byte table rather than by search.
+void crc32_force(uint32_t from, uint32_t to, uint32_t generator, uint8_t bytes[4]);
+
+// Lane parallel evaluation of many generators over the same data. Each
+// generator gets one 32 bit SIMD lane (16 per register with AVX-512, 8 with
+// AVX2). A byte step needs a per-lane table lookup, which shuffles and
+// permutes can't do since they share one table across lanes. Instead the
+// lookup is split by linearity into the eight rows T[1 << b], which are held
+// in registers and combined under per-bit masks.
+struct crc32_lane_set {
+    size_t count;
+    size_t lanes;
+    // basis[(group*8+b)*lanes+lane] = T[1 << b] for generator group*lanes+lane
+    std::vector<uint32_t> basis;
+};
+
+// SIMD width of crc32_update_lanes on this CPU, 0 if unsupported.
+size_t crc32_lane_width();
+
+// Only valid when crc32_lane_width() is non-zero.
+void crc32_build_lane_set(const uint32_t* generators, size_t count, crc32_lane_set& set);
+void crc32_update_lanes(const crc32_lane_set& set, uint32_t* crcs, const uint8_t* data, size_t len);
+
+const char* crc_kernel_name(crc_kernel kernel);
+// Returns false if the name doesn't match a known kernel.
+bool crc_kernel_from_name(const std::string& name, crc_kernel& kernel);
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef MSEXECRC_CRC_ENGINE_HDR
+#define MSEXECRC_CRC_ENGINE_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "crc32.h"
+#include "crc_generic.h"
+#include "crc_model.h"
+#include "dword_sum.h"
+
+// Non-owning view of a run of bytes.
+struct byte_span {
+    const uint8_t* data;
+    size_t size;
+};
+
+// Bytes at offset that changed from old_bytes to new_bytes, which must be
+// the same size.
+struct crc_edit {
+    uint64_t offset;
+    std::vector<uint8_t> old_bytes;
+    std::vector<uint8_t> new_bytes;
+};
+
+// Streaming CRC over data fed in any number of pieces. Reflected 32 bit
+// models run on the crc32.h kernels, every other model on crc_generic.h,
+// and crc_algorithm::dword_sum models on dword_sum.h.
+class crc_engine {
+    public:
+        explicit crc_engine(const crc_model& model, crc_kernel kernel = crc_kernel::automatic);
+
+        void update(byte_span data) {
+            update(data.data, data.size);
+        }
+        void update(const uint8_t* data, size_t len) {
+            if(summed) {
+                dword_sum_update(sums, data, len, (unsigned)(total & 3));
+            } else if(generic != nullptr) {
+                state = generic->update(state, data, len);
+            } else {
+                state = update_fn((uint32_t)state, data, len, *tables);
+            }
+            total += len;
+        }
+        // As if len zero bytes had been passed to update, in O(log len).
+        void update_zeros(uint64_t len);
+        // Continue with everything the other engine has seen. The other
+        // engine must use the same model and may have been started at any point.
+        void append(const crc_engine& tail);
+
+        // CRC of everything seen so far. The engine can keep being updated.
+        uint64_t finalize() const {
+            if(summed) {
+                return dword_sum_value(sums);
+            }
+            uint64_t out = (params.refin != params.refout) ? crc_reflect(state, params.width) : state;
+            return out ^ params.xorout;
+        }
+        // CRC of a message of the given length after the edits, from its CRC
+        // before them. Only the edited bytes are read and each edit costs
+        // O(log length), see crc_engine.cpp. Edits must lie inside the message.
+        uint64_t apply_edits(uint64_t crc, uint64_t length, const std::vector<crc_edit>& edits) const;
+        // New values for the 4 bytes old_bytes at offset so that a message
+        // of the given length with CRC crc gets the CRC target instead. False
+        // unless the model is a dword sum or a reflected 32 bit CRC with an
+        // invertible generator.
+        bool force(uint64_t crc, uint64_t length, uint64_t offset, const uint8_t old_bytes[4], uint64_t target, uint8_t new_bytes[4]) const;
+        void reset() {
+            state = init_state;
+            sums[0] = sums[1] = sums[2] = sums[3] = 0;
+            total = 0;
+        }
+        crc_engine clone() const {
+            return *this;
+        }
+
+        const crc_model& model() const {
+            return params;
+        }
+        uint64_t length() const {
+            return total;
+        }
+
+    private:
+        friend class crc_engine_set;
+
+        // Advance a register over len zero bytes.
+        uint64_t shift(uint64_t reg, uint64_t len) const;
+
+        crc_model params;
+        // Set for models without a crc32.h kernel.
+        const crc_generic_kernel* generic;
+        const crc32_tables* tables;
+        crc32_update_fn update_fn;
+        // Register value of init, reflected for refin models.
+        uint64_t init_state;
+        uint64_t state;
+        // Set for dword_sum models, which keep their byte lanes in sums.
+        bool summed;
+        uint64_t sums[4];
+        uint64_t total;
+};
+
+// Several engines fed the same data, using the lanes kernel when asked for it
+// and every model is a reflected 32 bit CRC.
+class crc_engine_set {
+    public:
+        crc_engine_set(const std::vector<crc_model>& models, crc_kernel kernel = crc_kernel::automatic);
+
+        void update(byte_span data) {
+            update(data.data, data.size);
+        }
+        void update(const uint8_t* data, size_t len);
+        void update_zeros(uint64_t len);
+        void append(const crc_engine_set& tail);
+
+        std::vector<uint64_t> finalize() const;
+        void reset();
+        crc_engine_set clone() const {
+            return *this;
+        }
+
+        size_t size() const {
+            return engines.size();
+        }
+        const crc_engine& engine(size_t i) const {
+            return engines[i];
+        }
+
+    private:
+        std::vector<crc_engine> engines;
+        bool use_lanes;
+        crc32_lane_set lane_set;
+        std::vector<uint32_t> lane_states;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MSEXECRC_CRC_GENERIC_HDR
+#define MSEXECRC_CRC_GENERIC_HDR
+
+#include <cstdint>
+#include <cstddef>
+
+// Slice-by-8 table kernels for 8, 16, 32 and 64 bit CRCs in either bit
+// order, each instantiated for its own register type. The register of a
+// reflected CRC holds the bit reversed value, as in crc32.h.
+
+typedef uint64_t (*crc_generic_update_fn)(uint64_t reg, const uint8_t* data, size_t len, const void* tables);
+
+struct crc_generic_kernel {
+    int width;
+    bool reflected;
+    uint64_t poly; // normal (MSB first) form without the x^width term
+    const void* tables;
+    crc_generic_update_fn update_fn;
+    // pow[k][i] is the image of register bit i after 2^k zero bytes.
+    const uint64_t (*pow)[64];
+
+    uint64_t update(uint64_t reg, const uint8_t* data, size_t len) const {
+        return update_fn(reg, data, len, tables);
+    }
+};
+
+// Width must be 8, 16, 32 or 64. Kernels are built on first use and cached
+// for the lifetime of the process. Safe to call from several threads.
+const crc_generic_kernel& crc_generic_get(int width, bool reflected, uint64_t poly);
+
+// Advance the register over len zero bytes in O(log len).
+uint64_t crc_generic_shift(const crc_generic_kernel& kernel, uint64_t reg, uint64_t len);
+
+// Reverse the low width bits of v.
+uint64_t crc_reflect(uint64_t v, int width);
+
+#endif
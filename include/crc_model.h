@@ -0,0 +1,60 @@
+#ifndef MSEXECRC_CRC_MODEL_HDR
+#define MSEXECRC_CRC_MODEL_HDR
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How a model's value is worked out.
+enum class crc_algorithm {
+    crc,
+    // 32 bit sum of the data as little endian dwords, a short last dword
+    // padded with zeros. The CRC parameters are all zero.
+    dword_sum,
+};
+
+// A CRC in the Rocksoft parameter model, as used by the reveng catalogue.
+// poly is in normal (MSB first) form without the x^width term, init is the
+// register value before reflection and check is the CRC of "123456789".
+struct crc_model {
+    std::string name;
+    int width;
+    uint64_t poly;
+    uint64_t init;
+    bool refin;
+    bool refout;
+    uint64_t xorout;
+    uint64_t check;
+    crc_algorithm algorithm = crc_algorithm::crc;
+};
+
+// The models of the generator sweep: a reflected 32 bit CRC started from ~0
+// and inverted at the end. They are unnamed.
+crc_model crc_sweep_model(uint32_t generator);
+
+// Every catalogued model, ordered by width, then the non-CRC checksums.
+const std::vector<crc_model>& crc_catalog();
+
+// Look a model up by name or alias, ignoring case. Returns false if unknown.
+bool crc_model_from_name(const std::string& name, crc_model& model);
+
+// Whether two models compute the same thing, whatever they're named.
+bool crc_model_same_params(const crc_model& a, const crc_model& b);
+
+// Give the model the name of the catalogued model with the same parameters.
+// Returns false, leaving it unchanged, if there is none.
+bool crc_model_lookup(crc_model& model);
+
+// "width=.. poly=.. init=.. refin=.. refout=.. xorout=.." with values in hex.
+std::string crc_model_describe(const crc_model& model);
+
+// Aliases of a catalogued model, joined with ", ".
+std::string crc_model_aliases(const crc_model& model);
+
+// CRC of data under a model in a single call.
+uint64_t crc_model_compute(const crc_model& model, const uint8_t* data, size_t len);
+
+// Whether the model reproduces its check value.
+bool crc_model_verify(const crc_model& model);
+
+#endif
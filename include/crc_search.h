@@ -0,0 +1,57 @@
+#ifndef MSEXECRC_CRC_SEARCH_HDR
+#define MSEXECRC_CRC_SEARCH_HDR
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "crc_model.h"
+#include "thread_pool.h"
+
+// Brute force search for 32 bit CRC models producing a known value.
+//
+// A CRC is affine in its initial register: for a polynomial P over L bytes
+// crc = xorout ^ out(shift(init, L) ^ R0), where R0 is the register of the
+// data started from zero and out() is the refout reflection. So each
+// polynomial and input reflection costs one pass over the data, and every
+// init, xorout and refout candidate is then checked with a single
+// multiplication mod P. Passes run 8 or 16 polynomials at a time on the
+// lanes kernel. MSB first CRCs run on the same kernel over a bit reversed
+// copy of the data, whose register is the reflection of the MSB first one.
+
+struct crc_search_space {
+    // Inclusive range of normal (MSB first) polynomials, only odd ones are tried.
+    uint32_t poly_first;
+    uint32_t poly_last;
+    std::vector<uint32_t> inits;
+    std::vector<uint32_t> xorouts;
+};
+
+struct crc_search_progress {
+    uint64_t polys_done;
+    uint64_t polys_total;
+    uint64_t bytes_done;
+    double seconds;
+};
+
+typedef std::function<void(const crc_search_progress&)> crc_search_progress_fn;
+
+class crc_search {
+    public:
+        // data is the checksummed stream with any masking already applied.
+        crc_search(std::vector<uint8_t> data, uint32_t target);
+
+        // Every model in the space reproducing the target, ordered by
+        // polynomial. Catalogued models carry their name. progress is called
+        // from the calling thread about once a second.
+        std::vector<crc_model> run(const crc_search_space& space, thread_pool& pool, const crc_search_progress_fn& progress) const;
+
+    private:
+        void check_batch(const crc_search_space& space, const uint32_t* polys, size_t count, std::vector<crc_model>& matches) const;
+
+        std::vector<uint8_t> data;
+        // data with the bits of every byte reversed.
+        std::vector<uint8_t> reversed;
+        uint32_t target;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MSEXECRC_CRC_SOLVE_HDR
+#define MSEXECRC_CRC_SOLVE_HDR
+
+#include <cstdint>
+#include <vector>
+
+// Recover the initial value and final xor of a 32 bit CRC from samples.
+//
+// With the register in reflected order, a sample of length L with stored
+// value S satisfies out(S) = shift(I, L) ^ R0 ^ out(xorout), where I is the
+// initial register, R0 the register of the data started from zero and
+// out() the reflection when refout differs from the register order. Each
+// sample gives 32 linear equations over GF(2) in the 64 unknown bits of I
+// and xorout, solved by Gaussian elimination.
+
+struct crc_sample {
+    uint64_t length;
+    uint32_t stored;
+    // Register of the checksummed data from zero, in reflected order.
+    uint32_t reg;
+};
+
+struct crc_solution {
+    // Rocksoft form, unreflected.
+    uint32_t init;
+    uint32_t xorout;
+    // Unknown bits left undetermined, 0 for a unique solution. The values
+    // above are then one solution with every free bit cleared.
+    int free_bits;
+};
+
+// Returns false if the samples are inconsistent with the generator.
+bool crc_solve_affine(uint32_t generator, bool refout, const std::vector<crc_sample>& samples, crc_solution& solution);
+
+#endif
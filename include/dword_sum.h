@@ -0,0 +1,22 @@
+#ifndef MSEXECRC_DWORD_SUM_HDR
+#define MSEXECRC_DWORD_SUM_HDR
+
+#include <cstdint>
+#include <cstddef>
+
+// The 32 bit additive checksum of data taken as little endian dwords. It's
+// kept as four byte sums, lanes[j] adding the bytes at positions j mod 4,
+// which don't carry into each other, so a sum can be moved to any position
+// and sums of pieces combined exactly.
+
+// Add len bytes whose first byte sits at position 'phase' mod 4.
+void dword_sum_update(uint64_t lanes[4], const uint8_t* data, size_t len, unsigned phase);
+
+// Add the lanes of a piece that starts at position 'phase' mod 4 of the
+// whole, its own lanes having been counted from position 0.
+void dword_sum_append(uint64_t lanes[4], const uint64_t tail[4], unsigned phase);
+
+// The sum of the dwords, modulo 2^32.
+uint32_t dword_sum_value(const uint64_t lanes[4]);
+
+#endif
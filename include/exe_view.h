@@ -0,0 +1,62 @@
+#ifndef MSEXECRC_EXE_VIEW_HDR
+#define MSEXECRC_EXE_VIEW_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "mz_header.h"
+
+// An entry of an NE style resident or non-resident name table, which LE
+// and LX share. The first entry of each is the module name or
+// description, with ordinal 0.
+struct ne_name {
+    std::string_view text;
+    uint16_t ordinal;
+};
+
+// The bounds checks and table walks the NE and LE parsers have in common,
+// over an image held in memory.
+class exe_view {
+    protected:
+        // Whether [offset, offset+len) lies inside the image.
+        bool contains(uint64_t offset, uint64_t len) const {
+            return (offset <= size)&&(len <= size-offset);
+        }
+        // A length prefixed string at offset, false if it doesn't fit.
+        bool pascal_string(uint64_t offset, std::string_view& text) const {
+            if(!contains(offset, 1)||!contains(offset+1, data[offset])) {
+                return false;
+            }
+            text = std::string_view((const char*)data+offset+1, data[offset]);
+            return true;
+        }
+        // fn(const ne_name&) for each entry of the name table at offset,
+        // up to the 0 length that ends it, which must come before end.
+        template<class Fn>
+        bool walk_names(uint64_t offset, uint64_t end, Fn fn) const;
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+};
+
+template<class Fn>
+bool exe_view::walk_names(uint64_t offset, uint64_t end, Fn fn) const {
+    for(;;) {
+        if((offset >= end)||!contains(offset, 1)) {
+            return false;
+        }
+        if(data[offset] == 0) {
+            return true;
+        }
+        ne_name name;
+        if(!pascal_string(offset, name.text)||!contains(offset+1+name.text.size(), 2)) {
+            return false;
+        }
+        offset += 1+name.text.size();
+        name.ordinal = load_le16(data+offset);
+        offset += 2;
+        fn(name);
+    }
+}
+
+#endif
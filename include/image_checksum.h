@@ -0,0 +1,24 @@
+#ifndef MSEXECRC_IMAGE_CHECKSUM_HDR
+#define MSEXECRC_IMAGE_CHECKSUM_HDR
+
+#include <cstdint>
+#include <cstddef>
+
+// The Microsoft PE image checksum, as CheckSumMappedFile in imagehlp works
+// it out: a 16 bit one's complement sum of the file as little endian words,
+// the stored checksum taken back out of it, plus the file length.
+//
+// The sum is kept unfolded in 64 bits, which folds to the same value as
+// imagehlp's fold after every word, so pieces of a file can be summed on
+// their own and added together in any order.
+
+// Add the len bytes found at file offset 'offset' to sum. A byte at an odd
+// offset is the high half of its word, and a final odd byte counts as a
+// word of its own, as imagehlp pads the file with a zero.
+uint64_t image_sum_update(uint64_t sum, const uint8_t* data, size_t len, uint64_t offset);
+
+// The checksum of a file of the given length whose words add up to sum
+// while its CheckSum field holds stored_checksum.
+uint32_t image_checksum_finish(uint64_t sum, uint64_t file_length, uint32_t stored_checksum);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MSEXECRC_INPUT_SOURCE_HDR
+#define MSEXECRC_INPUT_SOURCE_HDR
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "uring_reader.h"
+
+enum class input_mode {
+    automatic, // map the file, reading it with pread if that fails
+    mmap,
+    pread,
+    uring,     // io_uring reads, pread if io_uring isn't available
+};
+
+// Read-only input file. A mapped file is handed out in place, otherwise it
+// is read with pread in large blocks. Reads don't move any file position,
+// so one source can be read from several threads at once.
+class input_source {
+    public:
+        input_source() = default;
+        ~input_source();
+
+        input_source(const input_source&) = delete;
+        input_source& operator=(const input_source&) = delete;
+
+        // Returns false with a message in error if the file can't be opened,
+        // or can't be mapped in input_mode::mmap. queue_depth is the number
+        // of reads kept in flight by input_mode::uring.
+        bool open(const std::string& path, input_mode mode, std::string& error, unsigned queue_depth = 8);
+        void close();
+
+        uint64_t size() const {
+            return file_size;
+        }
+        bool mapped() const {
+            return mapping != nullptr;
+        }
+        int descriptor() const {
+            return fd;
+        }
+        // How the file is being read: "mmap", "pread" or "uring".
+        const char* reader_name() const;
+
+        // Up to len bytes at offset, fewer at the end of the file. Points into
+        // the mapping, or into scratch after a read. Returns false on a read error.
+        bool view(uint64_t offset, size_t len, std::vector<uint8_t>& scratch, const uint8_t*& data, size_t& got) const;
+
+        // Call fn(data, len, offset) over [offset, offset+len) in blocks of at
+        // most block_size. Returns false on a read error or a short file.
+        template<class Fn>
+        bool for_each_block(uint64_t offset, uint64_t len, size_t block_size, Fn fn) const;
+
+    private:
+        bool read_at(uint64_t offset, uint8_t* data, size_t len, size_t& got) const;
+        // The calling thread's ring, set up on first use. Null if io_uring isn't available.
+        uring_reader* thread_ring() const;
+
+        int fd = -1;
+        bool use_uring = false;
+        unsigned uring_depth = 0;
+        uint64_t file_size = 0;
+        const uint8_t* mapping = nullptr;
+};
+
+// Bytes per pread when the file isn't mapped.
+#define INPUT_READ_SIZE (1024*1024)
+
+template<class Fn>
+bool input_source::for_each_block(uint64_t offset, uint64_t len, size_t block_size, Fn fn) const {
+    if(offset+len > file_size) {
+        return false;
+    }
+    if(mapping != nullptr) {
+        for(uint64_t pos = offset; pos < offset+len; pos += block_size) {
+            size_t n = (size_t)std::min<uint64_t>(block_size, offset+len-pos);
+            fn(mapping+pos, n, pos);
+        }
+        return true;
+    }
+
+    auto split = [&](const uint8_t* data, size_t got, uint64_t pos) {
+        for(size_t done = 0; done < got; done += block_size) {
+            fn(data+done, std::min(block_size, got-done), pos+done);
+        }
+    };
+    uring_reader* ring = use_uring ? thread_ring() : nullptr;
+    if(ring != nullptr) {
+        return ring->read(fd, offset, len, split);
+    }
+
+    // Read large blocks and hand them out in block_size pieces.
+    std::vector<uint8_t> buf((size_t)std::min<uint64_t>(std::max<size_t>(INPUT_READ_SIZE, block_size), len));
+    for(uint64_t pos = offset; pos < offset+len;) {
+        size_t want = (size_t)std::min<uint64_t>(buf.size(), offset+len-pos);
+        size_t got;
+        if(!read_at(pos, buf.data(), want, got)||(got != want)) {
+            return false;
+        }
+        split(buf.data(), got, pos);
+        pos += got;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef MSEXECRC_LE_IMAGE_HDR
+#define MSEXECRC_LE_IMAGE_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "exe_view.h"
+
+// The fixed part of the LE and LX headers, LE VxDs carry a few more fields.
+#define LE_HEADER_SIZE 0xac
+
+// Object page table entries.
+#define LE_PAGE_ENTRY_SIZE 4
+#define LX_PAGE_ENTRY_SIZE 8
+
+// Page types, LX adds a few of its own.
+#define LE_PAGE_LEGAL    0
+#define LE_PAGE_ITERATED 1
+#define LE_PAGE_INVALID  2
+#define LE_PAGE_ZEROED   3
+
+struct le_object {
+    unsigned index; // 1 based
+    uint32_t virtual_size;
+    uint32_t base_address;
+    uint32_t flags;
+    uint32_t page_table_index; // 1 based, of the first page
+    uint32_t page_count;
+};
+
+struct le_page {
+    uint32_t index;       // 1 based entry of the object page table
+    uint64_t file_offset; // 0 for a page with no data in the file
+    uint32_t file_length;
+    uint16_t flags;
+};
+
+// Bounds checked view of an LE (VxD, Windows 3.x/9x) or LX (OS/2) image
+// held in memory, used the same way as ne_image: nothing is copied and each
+// table is walked as it's asked for. A walk returns false when the table
+// runs outside the image, after the callback has seen every good entry.
+class le_image : private exe_view {
+    public:
+        // Checks the MZ and LE or LX headers. The image must outlive this view.
+        bool parse(const uint8_t* data, size_t size, std::string& error);
+
+        uint32_t header_offset() const {
+            return le_offset;
+        }
+        bool lx() const {
+            return header[1] == 'X';
+        }
+        uint16_t cpu_type() const {
+            return load_le16(header+0x08);
+        }
+        uint16_t os_type() const {
+            return load_le16(header+0x0a);
+        }
+        uint32_t module_version() const {
+            return load_le32(header+0x0c);
+        }
+        uint32_t module_flags() const {
+            return load_le32(header+0x10);
+        }
+        uint32_t page_count() const {
+            return load_le32(header+0x14);
+        }
+        uint32_t page_size() const {
+            return load_le32(header+0x28);
+        }
+        // The same field is the last page's length in LE and the page
+        // offset shift in LX.
+        uint32_t last_page_size() const {
+            return lx() ? page_size() : load_le32(header+0x2c);
+        }
+        uint32_t page_shift() const {
+            return lx() ? load_le32(header+0x2c) : 0;
+        }
+        uint32_t object_count() const {
+            return load_le32(header+0x44);
+        }
+
+        // The loader section runs from the object table, the fixup section
+        // from the fixup page table. Their stored checksums have no defined
+        // algorithm and are 0 from most linkers.
+        uint64_t loader_section_offset() const {
+            return table(0x40);
+        }
+        uint32_t loader_section_size() const {
+            return load_le32(header+0x38);
+        }
+        uint32_t loader_section_checksum() const {
+            return load_le32(header+0x3c);
+        }
+        uint64_t fixup_section_offset() const {
+            return table(0x68);
+        }
+        uint32_t fixup_section_size() const {
+            return load_le32(header+0x30);
+        }
+        uint32_t fixup_section_checksum() const {
+            return load_le32(header+0x34);
+        }
+        uint32_t nonresident_name_checksum() const {
+            return load_le32(header+0x90);
+        }
+        // The stored checksum of a page, false when there's no per-page
+        // checksum table or it doesn't cover the page.
+        bool page_checksum(uint32_t index, uint32_t& checksum) const;
+        // One past the last byte the header and tables account for, as
+        // ne_image::image_end.
+        bool image_end(uint64_t& end) const;
+
+        // fn(const le_object&)
+        template<class Fn>
+        bool for_each_object(Fn fn) const;
+        // fn(const le_page&) for every page of one object.
+        template<class Fn>
+        bool for_each_page(const le_object& object, Fn fn) const;
+        // fn(const ne_name&), the name tables are laid out as in NE.
+        template<class Fn>
+        bool for_each_resident_name(Fn fn) const;
+        template<class Fn>
+        bool for_each_nonresident_name(Fn fn) const;
+        // fn(std::string_view) for each imported module, in order.
+        template<class Fn>
+        bool for_each_module(Fn fn) const;
+
+    private:
+        // Absolute offset of a table given relative to the LE header.
+        uint64_t table(size_t field) const {
+            return (uint64_t)le_offset+load_le32(header+field);
+        }
+
+        const uint8_t* header = nullptr;
+        uint32_t le_offset = 0;
+};
+
+template<class Fn>
+bool le_image::for_each_object(Fn fn) const {
+    uint64_t offset = table(0x40);
+    uint32_t count = object_count();
+    if(!contains(offset, (uint64_t)count*24)) {
+        return false;
+    }
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint8_t* p = data+offset+(uint64_t)i*24;
+        le_object object;
+        object.index = i+1;
+        object.virtual_size = load_le32(p);
+        object.base_address = load_le32(p+4);
+        object.flags = load_le32(p+8);
+        object.page_table_index = load_le32(p+12);
+        object.page_count = load_le32(p+16);
+        fn(object);
+    }
+    return true;
+}
+
+template<class Fn>
+bool le_image::for_each_page(const le_object& object, Fn fn) const {
+    if(object.page_count == 0) {
+        return true;
+    }
+    size_t entry_size = lx() ? LX_PAGE_ENTRY_SIZE : LE_PAGE_ENTRY_SIZE;
+    uint64_t first = (uint64_t)object.page_table_index;
+    if((first == 0)||(first-1+object.page_count > page_count())) {
+        return false;
+    }
+    uint64_t offset = table(0x48)+(first-1)*entry_size;
+    if(!contains(offset, (uint64_t)object.page_count*entry_size)) {
+        return false;
+    }
+    uint64_t data_pages = load_le32(header+0x80);
+    uint64_t iterated_pages = load_le32(header+0x4c);
+    for(uint32_t i = 0; i < object.page_count; ++i) {
+        const uint8_t* p = data+offset+(uint64_t)i*entry_size;
+        le_page page;
+        page.index = (uint32_t)first+i;
+        uint64_t at;
+        if(lx()) {
+            page.flags = load_le16(p+6);
+            page.file_length = load_le16(p+4);
+            // Iterated pages may have a section of their own.
+            uint64_t base = ((page.flags == LE_PAGE_ITERATED)&&(iterated_pages != 0)) ? iterated_pages : data_pages;
+            at = base+((uint64_t)load_le32(p) << page_shift());
+        } else {
+            // A 24 bit page number, high byte first, then the type.
+            uint32_t number = ((uint32_t)p[0] << 16)|(p[1] << 8)|p[2];
+            page.flags = p[3];
+            page.file_length = (number == page_count()) ? last_page_size() : page_size();
+            at = (number == 0) ? 0 : data_pages+(uint64_t)(number-1)*page_size();
+        }
+        if((page.flags == LE_PAGE_INVALID)||(page.flags == LE_PAGE_ZEROED)||(at == 0)||(page.file_length == 0)) {
+            page.file_offset = 0;
+            page.file_length = 0;
+        } else {
+            page.file_offset = at;
+            if(!contains(page.file_offset, page.file_length)) {
+                return false;
+            }
+        }
+        fn(page);
+    }
+    return true;
+}
+
+template<class Fn>
+bool le_image::for_each_resident_name(Fn fn) const {
+    if(load_le32(header+0x58) == 0) {
+        return true;
+    }
+    return walk_names(table(0x58), size, fn);
+}
+
+template<class Fn>
+bool le_image::for_each_nonresident_name(Fn fn) const {
+    uint64_t offset = load_le32(header+0x88);
+    uint32_t length = load_le32(header+0x8c);
+    if((offset == 0)||(length == 0)) {
+        return true;
+    }
+    if(!contains(offset, length)) {
+        return false;
+    }
+    return walk_names(offset, offset+length, fn);
+}
+
+template<class Fn>
+bool le_image::for_each_module(Fn fn) const {
+    uint32_t count = load_le32(header+0x74);
+    uint64_t offset = table(0x70);
+    for(uint32_t i = 0; i < count; ++i) {
+        std::string_view text;
+        if(!pascal_string(offset, text)) {
+            return false;
+        }
+        offset += 1+text.size();
+        fn(text);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef MSEXECRC_MASK_LIST_HDR
+#define MSEXECRC_MASK_LIST_HDR
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What happens to the bytes of a masked range.
+enum class mask_mode {
+    zero,    // checksummed as if they were zero
+    exclude, // left out of the checksum entirely
+};
+
+struct mask_range {
+    uint64_t offset;
+    uint64_t length;
+    mask_mode mode;
+    std::string label;
+
+    uint64_t end() const {
+        return offset+length;
+    }
+};
+
+// Sorted, non-overlapping list of masked file ranges. Data is fed to a sink
+// split into clean and masked sub-ranges, so the clean parts go straight to
+// the fast kernels without any per-byte test. A sink needs
+// update(const uint8_t*, size_t) and update_zeros(uint64_t).
+class mask_list {
+    public:
+        // Where ranges overlap exclude wins over zero.
+        void add(uint64_t offset, uint64_t length, mask_mode mode, const std::string& label);
+
+        const std::vector<mask_range>& ranges() const {
+            return sorted;
+        }
+        bool empty() const {
+            return sorted.empty();
+        }
+
+        // Index of the first range ending after offset.
+        size_t first_after(uint64_t offset) const;
+
+        // Feed the bytes [data, data+len) found at file offset 'offset'.
+        template<class Sink>
+        void feed(Sink& sink, const uint8_t* data, size_t len, uint64_t offset) const;
+
+        // Call fn(range, file offset, value) for every masked byte in the buffer.
+        template<class Fn>
+        void for_each_masked(const uint8_t* data, size_t len, uint64_t offset, Fn fn) const;
+
+    private:
+        std::vector<mask_range> sorted;
+};
+
+template<class Sink>
+void mask_list::feed(Sink& sink, const uint8_t* data, size_t len, uint64_t offset) const {
+    uint64_t end = offset+len;
+    uint64_t pos = offset;
+    for(size_t r = first_after(offset); (r < sorted.size())&&(sorted[r].offset < end); ++r) {
+        const mask_range& range = sorted[r];
+        if(range.offset > pos) {
+            sink.update(data+(pos-offset), range.offset-pos);
+            pos = range.offset;
+        }
+        uint64_t masked_end = std::min(range.end(), end);
+        if(range.mode == mask_mode::zero) {
+            sink.update_zeros(masked_end-pos);
+        }
+        pos = masked_end;
+    }
+    if(pos < end) {
+        sink.update(data+(pos-offset), end-pos);
+    }
+}
+
+template<class Fn>
+void mask_list::for_each_masked(const uint8_t* data, size_t len, uint64_t offset, Fn fn) const {
+    uint64_t end = offset+len;
+    for(size_t r = first_after(offset); (r < sorted.size())&&(sorted[r].offset < end); ++r) {
+        const mask_range& range = sorted[r];
+        uint64_t masked_end = std::min(range.end(), end);
+        for(uint64_t i = std::max(range.offset, offset); i < masked_end; ++i) {
+            fn(range, i, data[i-offset]);
+        }
+    }
+}
+
+// Parse "offset:length", each in decimal or 0x prefixed hex. False when the
+// range would run past the end of a 64 bit offset.
+bool parse_mask_range(const std::string& text, uint64_t& offset, uint64_t& length);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MSEXECRC_MZ_HEADER_HDR
+#define MSEXECRC_MZ_HEADER_HDR
+
+#include <cstdint>
+#include <cstddef>
+
+// Little endian loads that don't care about alignment.
+inline uint16_t load_le16(const uint8_t* p) {
+    return (uint16_t)(p[0]|(p[1] << 8));
+}
+inline uint32_t load_le32(const uint8_t* p) {
+    return (uint32_t)p[0]|((uint32_t)p[1] << 8)|((uint32_t)p[2] << 16)|((uint32_t)p[3] << 24);
+}
+
+// Offsets into the MZ header.
+#define MZ_HEADER_SIZE   0x40
+#define MZ_CBLP          0x02
+#define MZ_CP            0x04
+#define MZ_CSUM          0x12
+#define MZ_LFANEW        0x3c
+
+struct mz_header {
+    uint16_t checksum; // e_csum
+    // Bytes of the DOS image from e_cp and e_cblp, which may run past the
+    // end of the file.
+    uint64_t image_size;
+};
+
+// False unless data holds a whole MZ header.
+bool mz_parse_header(const uint8_t* data, size_t len, mz_header& header);
+
+// The e_csum that makes the 16 bit words of the DOS image, e_csum included,
+// add up to 0xffff. sum is the image's word sum as image_sum_update gives it,
+// taken while e_csum held stored_checksum.
+uint16_t mz_checksum_finish(uint64_t sum, uint16_t stored_checksum);
+
+#endif
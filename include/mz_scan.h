@@ -0,0 +1,14 @@
+#ifndef MSEXECRC_MZ_SCAN_HDR
+#define MSEXECRC_MZ_SCAN_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Append offset+i to hits for every i where data[i] and data[i+1] are "MZ",
+// the first bytes of a candidate executable. A pair split across two calls
+// isn't seen, the caller checks the last byte of one block against the
+// first of the next.
+void mz_scan(const uint8_t* data, size_t len, uint64_t offset, std::vector<uint64_t>& hits);
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef MSEXECRC_NE_IMAGE_HDR
+#define MSEXECRC_NE_IMAGE_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "exe_view.h"
+
+// Offsets into the NE header.
+#define NE_HEADER_SIZE   0x40
+#define NE_CRC_OFFSET    0x08
+
+// Segment flags.
+#define NE_SEGMENT_DATA      0x0001
+#define NE_SEGMENT_RELOCINFO 0x0100
+
+struct ne_segment {
+    unsigned index;       // 1 based, as used by entries and relocations
+    uint64_t file_offset; // 0 for a segment with no data in the file
+    uint32_t file_length;
+    uint16_t flags;
+    uint32_t min_alloc;
+    // Where the relocation records start, only set with NE_SEGMENT_RELOCINFO.
+    uint64_t relocation_offset;
+    uint16_t relocation_count;
+};
+
+// One 8 byte relocation record, the target words are kept as stored.
+struct ne_relocation {
+    uint8_t source_type;
+    uint8_t flags;
+    uint16_t offset;
+    uint16_t target1;
+    uint16_t target2;
+};
+
+struct ne_resource {
+    uint16_t type_id;           // high bit set for an integer type
+    std::string_view type_name; // empty for an integer type
+    uint16_t id;                // high bit set for an integer id
+    std::string_view name;      // empty for an integer id
+    uint64_t file_offset;
+    uint64_t file_length;
+    uint16_t flags;
+};
+
+struct ne_entry {
+    uint16_t ordinal;
+    uint8_t segment; // 0xfe for a constant
+    uint16_t offset;
+    uint8_t flags;
+    bool movable;
+};
+
+// Bounds checked view of an NE image held in memory, such as a mapped file.
+// Nothing is copied: the header is read in place and each table is walked
+// as it's asked for, handing the callback entries that point back into the
+// image. A walk returns false when the table runs outside the image or is
+// otherwise malformed, after the callback has seen every good entry.
+class ne_image : private exe_view {
+    public:
+        // Checks the MZ and NE headers. The image must outlive this view.
+        bool parse(const uint8_t* data, size_t size, std::string& error);
+
+        uint32_t header_offset() const {
+            return ne_offset;
+        }
+        // Offset of the 4 byte CRC field from the start of the file.
+        uint32_t crc_offset() const {
+            return ne_offset+NE_CRC_OFFSET;
+        }
+        uint32_t stored_crc() const {
+            return load_le32(header+NE_CRC_OFFSET);
+        }
+        uint8_t linker_version() const {
+            return header[0x02];
+        }
+        uint8_t linker_revision() const {
+            return header[0x03];
+        }
+        uint16_t flags() const {
+            return load_le16(header+0x0c);
+        }
+        uint16_t segment_count() const {
+            return load_le16(header+0x1c);
+        }
+        uint16_t module_count() const {
+            return load_le16(header+0x1e);
+        }
+        uint16_t alignment_shift() const {
+            // 0 means the default of 512 byte sectors.
+            uint16_t shift = load_le16(header+0x32);
+            return (shift == 0) ? 9 : shift;
+        }
+        uint8_t target_os() const {
+            return header[0x36];
+        }
+        uint16_t expected_windows_version() const {
+            return load_le16(header+0x3e);
+        }
+        // One past the last byte the header and tables account for, which
+        // is where an image carved out of a larger file ends. False if a
+        // table runs outside the view.
+        bool image_end(uint64_t& end) const;
+
+        // fn(const ne_segment&)
+        template<class Fn>
+        bool for_each_segment(Fn fn) const;
+        // fn(const ne_relocation&) for every record of one segment.
+        template<class Fn>
+        bool for_each_relocation(const ne_segment& segment, Fn fn) const;
+        // fn(const ne_resource&)
+        template<class Fn>
+        bool for_each_resource(Fn fn) const;
+        // fn(const ne_name&)
+        template<class Fn>
+        bool for_each_resident_name(Fn fn) const;
+        template<class Fn>
+        bool for_each_nonresident_name(Fn fn) const;
+        // fn(std::string_view) for each module reference, in order.
+        template<class Fn>
+        bool for_each_module(Fn fn) const;
+        // fn(const ne_entry&) for every used ordinal.
+        template<class Fn>
+        bool for_each_entry(Fn fn) const;
+
+    private:
+        // Absolute offset of a table given relative to the NE header.
+        uint64_t table(size_t field) const {
+            return (uint64_t)ne_offset+load_le16(header+field);
+        }
+
+        const uint8_t* header = nullptr;
+        uint32_t ne_offset = 0;
+};
+
+template<class Fn>
+bool ne_image::for_each_segment(Fn fn) const {
+    uint64_t offset = table(0x22);
+    unsigned count = segment_count();
+    if(!contains(offset, (uint64_t)count*8)) {
+        return false;
+    }
+    unsigned shift = alignment_shift();
+    if(shift > 31) {
+        return false;
+    }
+    for(unsigned i = 0; i < count; ++i) {
+        const uint8_t* p = data+offset+i*8;
+        ne_segment segment;
+        segment.index = i+1;
+        segment.file_offset = (uint64_t)load_le16(p) << shift;
+        uint16_t length = load_le16(p+2);
+        segment.file_length = (length == 0 && segment.file_offset != 0) ? 0x10000 : length;
+        segment.flags = load_le16(p+4);
+        uint16_t min_alloc = load_le16(p+6);
+        segment.min_alloc = (min_alloc == 0) ? 0x10000 : min_alloc;
+        segment.relocation_offset = 0;
+        segment.relocation_count = 0;
+        if((segment.file_offset != 0)&&!contains(segment.file_offset, segment.file_length)) {
+            return false;
+        }
+        if((segment.file_offset != 0)&&(segment.flags & NE_SEGMENT_RELOCINFO)) {
+            uint64_t at = segment.file_offset+segment.file_length;
+            if(!contains(at, 2)) {
+                return false;
+            }
+            segment.relocation_count = load_le16(data+at);
+            segment.relocation_offset = at+2;
+            if(!contains(segment.relocation_offset, (uint64_t)segment.relocation_count*8)) {
+                return false;
+            }
+        }
+        fn(segment);
+    }
+    return true;
+}
+
+template<class Fn>
+bool ne_image::for_each_relocation(const ne_segment& segment, Fn fn) const {
+    if(!contains(segment.relocation_offset, (uint64_t)segment.relocation_count*8)) {
+        return false;
+    }
+    for(unsigned i = 0; i < segment.relocation_count; ++i) {
+        const uint8_t* p = data+segment.relocation_offset+i*8;
+        ne_relocation relocation;
+        relocation.source_type = p[0];
+        relocation.flags = p[1];
+        relocation.offset = load_le16(p+2);
+        relocation.target1 = load_le16(p+4);
+        relocation.target2 = load_le16(p+6);
+        fn(relocation);
+    }
+    return true;
+}
+
+template<class Fn>
+bool ne_image::for_each_resource(Fn fn) const {
+    uint64_t base = table(0x24);
+    // No resource table when it would start at the resident name table.
+    if(load_le16(header+0x24) == load_le16(header+0x26)) {
+        return true;
+    }
+    if(!contains(base, 2)) {
+        return false;
+    }
+    unsigned shift = load_le16(data+base);
+    if(shift > 31) {
+        return false;
+    }
+    uint64_t offset = base+2;
+    for(;;) {
+        if(!contains(offset, 2)) {
+            return false;
+        }
+        uint16_t type_id = load_le16(data+offset);
+        if(type_id == 0) {
+            return true;
+        }
+        if(!contains(offset, 8)) {
+            return false;
+        }
+        uint16_t count = load_le16(data+offset+2);
+        ne_resource resource;
+        resource.type_id = type_id;
+        if(!(type_id & 0x8000)&&!pascal_string(base+type_id, resource.type_name)) {
+            return false;
+        }
+        offset += 8;
+        if(!contains(offset, (uint64_t)count*12)) {
+            return false;
+        }
+        for(unsigned i = 0; i < count; ++i, offset += 12) {
+            const uint8_t* p = data+offset;
+            resource.file_offset = (uint64_t)load_le16(p) << shift;
+            resource.file_length = (uint64_t)load_le16(p+2) << shift;
+            resource.flags = load_le16(p+4);
+            resource.id = load_le16(p+6);
+            resource.name = std::string_view();
+            if(!(resource.id & 0x8000)&&!pascal_string(base+resource.id, resource.name)) {
+                return false;
+            }
+            fn(resource);
+        }
+    }
+}
+
+template<class Fn>
+bool ne_image::for_each_resident_name(Fn fn) const {
+    return walk_names(table(0x26), size, fn);
+}
+
+template<class Fn>
+bool ne_image::for_each_nonresident_name(Fn fn) const {
+    uint64_t offset = load_le32(header+0x2c);
+    uint16_t length = load_le16(header+0x20);
+    if(length == 0) {
+        return true;
+    }
+    if(!contains(offset, length)) {
+        return false;
+    }
+    return walk_names(offset, offset+length, fn);
+}
+
+template<class Fn>
+bool ne_image::for_each_module(Fn fn) const {
+    uint64_t refs = table(0x28);
+    uint64_t names = table(0x2a);
+    unsigned count = module_count();
+    if(!contains(refs, (uint64_t)count*2)) {
+        return false;
+    }
+    for(unsigned i = 0; i < count; ++i) {
+        std::string_view text;
+        if(!pascal_string(names+load_le16(data+refs+i*2), text)) {
+            return false;
+        }
+        fn(text);
+    }
+    return true;
+}
+
+template<class Fn>
+bool ne_image::for_each_entry(Fn fn) const {
+    uint64_t offset = table(0x04);
+    uint64_t end = offset+load_le16(header+0x06);
+    if(!contains(offset, end-offset)) {
+        return false;
+    }
+    uint16_t ordinal = 1;
+    while(offset < end) {
+        uint8_t count = data[offset];
+        if(count == 0) {
+            return true;
+        }
+        if(offset+2 > end) {
+            return false;
+        }
+        uint8_t indicator = data[offset+1];
+        offset += 2;
+        if(indicator == 0) {
+            // Unused ordinals.
+            ordinal += count;
+            continue;
+        }
+        bool movable = (indicator == 0xff);
+        size_t entry_size = movable ? 6 : 3;
+        if(offset+(uint64_t)count*entry_size > end) {
+            return false;
+        }
+        for(unsigned i = 0; i < count; ++i, ++ordinal, offset += entry_size) {
+            const uint8_t* p = data+offset;
+            ne_entry entry;
+            entry.ordinal = ordinal;
+            entry.flags = p[0];
+            entry.movable = movable;
+            entry.segment = movable ? p[3] : indicator;
+            entry.offset = movable ? load_le16(p+4) : load_le16(p+1);
+            fn(entry);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MSEXECRC_PE_IMAGE_HDR
+#define MSEXECRC_PE_IMAGE_HDR
+
+#include <cstdint>
+#include <cstddef>
+
+// Offsets from the "PE\0\0" signature, which e_lfanew points at.
+#define PE_SIGNATURE_SIZE    4
+#define PE_FILE_HEADER_SIZE  20
+#define PE_OPTIONAL_OFFSET   (PE_SIGNATURE_SIZE+PE_FILE_HEADER_SIZE)
+// OptionalHeader.CheckSum sits at the same place in PE32 and PE32+.
+#define PE_CHECKSUM_OFFSET   (PE_OPTIONAL_OFFSET+64)
+
+#define PE_MAGIC_PE32      0x10b
+#define PE_MAGIC_PE32_PLUS 0x20b
+
+// The fields of the PE headers we use.
+struct pe_header {
+    uint16_t machine;
+    uint16_t section_count;
+    bool pe32_plus;
+    uint32_t checksum;
+    uint16_t subsystem;
+};
+
+// Read the headers starting at the PE signature, with len bytes available.
+// False if they aren't a PE32 or PE32+ header or don't fit.
+bool pe_parse_header(const uint8_t* data, size_t len, pe_header& header);
+
+// One past the last byte of the image starting with the MZ header at data,
+// from the headers, the raw data of the sections and the certificate table.
+// Anything appended after those isn't seen. False if the headers don't fit
+// in len bytes.
+bool pe_image_end(const uint8_t* data, size_t len, uint64_t& end);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef MSEXECRC_THREAD_POOL_HDR
+#define MSEXECRC_THREAD_POOL_HDR
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads running queued tasks.
+class thread_pool {
+    public:
+        // num_threads of 0 uses one thread per hardware thread.
+        explicit thread_pool(size_t num_threads);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        void submit(std::function<void()> task);
+        // Block until every submitted task has finished.
+        void wait();
+        // Like wait, but gives up after timeout. Returns true if every task has finished.
+        bool wait_for(std::chrono::milliseconds timeout);
+
+        size_t size() const {
+            return workers.size();
+        }
+
+        static size_t hardware_threads();
+
+    private:
+        void run();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable task_ready;
+        std::condition_variable all_done;
+        size_t active = 0;
+        bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MSEXECRC_URING_READER_HDR
+#define MSEXECRC_URING_READER_HDR
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+typedef std::function<void(const uint8_t* data, size_t len, uint64_t offset)> block_fn;
+
+// Sequential file reader on io_uring, set up with raw system calls. Keeps
+// queue_depth reads of block_size bytes in flight into registered buffers,
+// and hands the blocks back in file order while later reads proceed.
+class uring_reader {
+    public:
+        uring_reader() = default;
+        ~uring_reader();
+
+        uring_reader(const uring_reader&) = delete;
+        uring_reader& operator=(const uring_reader&) = delete;
+
+        // Returns false if io_uring isn't available, the reader is then unusable.
+        bool init(unsigned queue_depth, size_t block_size);
+        bool ready() const {
+            return ring_fd >= 0;
+        }
+        unsigned depth() const {
+            return queue_depth;
+        }
+
+        // Read [offset, offset+len) of fd, calling fn on each block. Returns
+        // false on a read error or a short file.
+        bool read(int fd, uint64_t offset, uint64_t len, const block_fn& fn);
+
+    private:
+        struct slot {
+            uint64_t offset;
+            size_t len;
+            size_t filled;
+            bool done;
+        };
+
+        void close();
+        void queue_read(int fd, unsigned index);
+        // Hand every queued read to the kernel, with wait then block until
+        // at least one has completed.
+        bool submit(bool wait);
+        // Give up on a ring that can't be driven any more. Closing it
+        // cancels the reads still aimed at the buffers.
+        void abandon();
+
+        int ring_fd = -1;
+        unsigned queue_depth = 0;
+        size_t block_size = 0;
+        bool fixed_buffers = false;
+        bool broken = false;
+        // Reads queued in the submission ring the kernel hasn't taken yet.
+        unsigned unsubmitted = 0;
+
+        void* sq_ring = nullptr;
+        size_t sq_ring_size = 0;
+        void* cq_ring = nullptr;
+        size_t cq_ring_size = 0;
+        void* sqe_memory = nullptr;
+        size_t sqe_size = 0;
+
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        void* cqes = nullptr;
+
+        std::vector<uint8_t*> buffers;
+        std::vector<slot> slots;
+};
+
+#endif
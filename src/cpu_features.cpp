@@ -0,0 +1,20 @@
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+bool cpu_has_avx2() {
+    static const bool have = __builtin_cpu_supports("avx2");
+    return have;
+}
+
+#else
+
+bool cpu_has_avx2() {
+    return false;
+}
+
+#endif
+
+const char* avx2_kernel_name() {
+    return cpu_has_avx2() ? "avx2" : "scalar";
+}
@@ -0,0 +1,328 @@
+#include "crc32.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Slicing-by-N follows the approach described in:
+// "A Systematic Approach to Building High Performance Software-based CRC Generators" (Kounavis, Berry)
+
+static inline uint32_t load_le32(const uint8_t* p) {
+    return ((uint32_t)p[0])|((uint32_t)p[1] << 8)|((uint32_t)p[2] << 16)|((uint32_t)p[3] << 24);
+}
+
+void crc32_build_tables(uint32_t generator, crc32_tables& tables) {
+    tables = crc32_make_tables(generator);
+}
+
+// Kernel bodies, inlined into the generic and the generator specialized kernels.
+__attribute__((always_inline))
+static inline uint32_t crc32_bytewise_body(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    const uint32_t* t0 = tables.t[0];
+    for(size_t i = 0; i < len; ++i) {
+        crc = (crc >> 8) ^ t0[(crc & 0xff) ^ data[i]];
+    }
+    return crc;
+}
+
+__attribute__((always_inline))
+static inline uint32_t crc32_slice8_body(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    const uint32_t (*t)[256] = tables.t;
+    while(len >= 8) {
+        uint32_t w0 = load_le32(data) ^ crc;
+        uint32_t w1 = load_le32(data+4);
+        crc = t[7][w0 & 0xff] ^ t[6][(w0 >> 8) & 0xff] ^ t[5][(w0 >> 16) & 0xff] ^ t[4][w0 >> 24] ^
+              t[3][w1 & 0xff] ^ t[2][(w1 >> 8) & 0xff] ^ t[1][(w1 >> 16) & 0xff] ^ t[0][w1 >> 24];
+        data += 8;
+        len -= 8;
+    }
+    return crc32_bytewise_body(crc, data, len, tables);
+}
+
+__attribute__((always_inline))
+static inline uint32_t crc32_slice16_body(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    const uint32_t (*t)[256] = tables.t;
+    while(len >= 16) {
+        uint32_t w0 = load_le32(data) ^ crc;
+        uint32_t w1 = load_le32(data+4);
+        uint32_t w2 = load_le32(data+8);
+        uint32_t w3 = load_le32(data+12);
+        crc = t[15][w0 & 0xff] ^ t[14][(w0 >> 8) & 0xff] ^ t[13][(w0 >> 16) & 0xff] ^ t[12][w0 >> 24] ^
+              t[11][w1 & 0xff] ^ t[10][(w1 >> 8) & 0xff] ^ t[9][(w1 >> 16) & 0xff] ^ t[8][w1 >> 24] ^
+              t[7][w2 & 0xff] ^ t[6][(w2 >> 8) & 0xff] ^ t[5][(w2 >> 16) & 0xff] ^ t[4][w2 >> 24] ^
+              t[3][w3 & 0xff] ^ t[2][(w3 >> 8) & 0xff] ^ t[1][(w3 >> 16) & 0xff] ^ t[0][w3 >> 24];
+        data += 16;
+        len -= 16;
+    }
+    return crc32_bytewise_body(crc, data, len, tables);
+}
+
+uint32_t crc32_update_bytewise(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    return crc32_bytewise_body(crc, data, len, tables);
+}
+
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    return crc32_slice8_body(crc, data, len, tables);
+}
+
+uint32_t crc32_update_slice16(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    return crc32_slice16_body(crc, data, len, tables);
+}
+
+// Kernels specialized on a generator, the passed tables are ignored.
+template<uint32_t Generator>
+static uint32_t crc32_update_bytewise_fixed(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables&) {
+    return crc32_bytewise_body(crc, data, len, crc32_static_tables<Generator>::value);
+}
+
+template<uint32_t Generator>
+static uint32_t crc32_update_slice8_fixed(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables&) {
+    return crc32_slice8_body(crc, data, len, crc32_static_tables<Generator>::value);
+}
+
+template<uint32_t Generator>
+static uint32_t crc32_update_slice16_fixed(uint32_t crc, const uint8_t* data, size_t len, const crc32_tables&) {
+    return crc32_slice16_body(crc, data, len, crc32_static_tables<Generator>::value);
+}
+
+struct crc32_fixed_entry {
+    uint32_t generator;
+    const crc32_tables* tables;
+    crc32_update_fn bytewise;
+    crc32_update_fn slice8;
+    crc32_update_fn slice16;
+};
+
+template<uint32_t Generator>
+constexpr crc32_fixed_entry crc32_fixed() {
+    return { Generator, &crc32_static_tables<Generator>::value, &crc32_update_bytewise_fixed<Generator>, &crc32_update_slice8_fixed<Generator>, &crc32_update_slice16_fixed<Generator> };
+}
+
+// The generators of the default sweep.
+static const crc32_fixed_entry crc32_fixed_generators[] = {
+    crc32_fixed<0x04C11DB7>(), crc32_fixed<0xEDB88320>(), // CRC-32
+    crc32_fixed<0x1EDC6F41>(), crc32_fixed<0x82F63B78>(), // CRC-32C
+    crc32_fixed<0x741B8CD7>(), crc32_fixed<0xEB31D82E>(), // CRC-32K
+    crc32_fixed<0x32583499>(), crc32_fixed<0x992C1A4C>(), // CRC-32K2
+    crc32_fixed<0x814141AB>(), crc32_fixed<0xD5828281>(), // CRC-32Q
+};
+
+static const crc32_fixed_entry* crc32_find_fixed(uint32_t generator) {
+    for(const crc32_fixed_entry& entry : crc32_fixed_generators) {
+        if(entry.generator == generator) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const crc32_tables& crc32_get_tables(uint32_t generator) {
+    const crc32_fixed_entry* fixed = crc32_find_fixed(generator);
+    if(fixed != nullptr) {
+        return *fixed->tables;
+    }
+
+    static std::mutex cache_mutex;
+    static std::unordered_map<uint32_t, std::unique_ptr<crc32_tables>> cache;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::unique_ptr<crc32_tables>& entry = cache[generator];
+    if(!entry) {
+        entry.reset(new crc32_tables);
+        crc32_build_tables(generator, *entry);
+    }
+    return *entry;
+}
+
+crc32_update_fn crc32_select_update(crc_kernel kernel, uint32_t generator) {
+    if(kernel == crc_kernel::lanes) {
+        kernel = crc_kernel::automatic;
+    }
+    kernel = crc32_resolve_kernel(kernel);
+    const crc32_fixed_entry* fixed = crc32_find_fixed(generator);
+    switch(kernel) {
+        case crc_kernel::bytewise:
+            return fixed ? fixed->bytewise : &crc32_update_bytewise;
+        case crc_kernel::slice8:
+            return fixed ? fixed->slice8 : &crc32_update_slice8;
+        case crc_kernel::slice16:
+            return fixed ? fixed->slice16 : &crc32_update_slice16;
+        case crc_kernel::clmul:
+            return &crc32_update_clmul;
+        default:
+            return fixed ? fixed->slice16 : &crc32_update_slice16;
+    }
+}
+
+uint32_t crc32_matrix_apply(const crc32_matrix& m, uint32_t v) {
+    uint32_t r = 0;
+    for(int i = 0; v != 0; ++i, v >>= 1) {
+        if(v & 1) {
+            r ^= m.col[i];
+        }
+    }
+    return r;
+}
+
+static void crc32_matrix_square(const crc32_matrix& m, crc32_matrix& sq) {
+    for(int i = 0; i < 32; ++i) {
+        sq.col[i] = crc32_matrix_apply(m, m.col[i]);
+    }
+}
+
+// pow[k] advances the register over 2^k zero bytes.
+struct crc32_shift_powers {
+    crc32_matrix pow[64];
+    // The same for stepping back, only built for invertible generators.
+    crc32_matrix inv_pow[64];
+};
+
+// One zero byte backwards. The top byte of T[i] is unique to i when the
+// generator is invertible, so it gives the index the forward step used.
+static uint32_t crc32_unshift_byte(uint32_t r, const crc32_tables& tables, const uint8_t* inverse) {
+    uint8_t idx = inverse[r >> 24];
+    return ((r ^ tables.t[0][idx]) << 8) | idx;
+}
+
+static void crc32_build_inverse(const crc32_tables& tables, uint8_t* inverse) {
+    for(int i = 0; i < 256; ++i) {
+        inverse[tables.t[0][i] >> 24] = (uint8_t)i;
+    }
+}
+
+static const crc32_shift_powers& crc32_get_shift_powers(uint32_t generator) {
+    static std::mutex cache_mutex;
+    static std::unordered_map<uint32_t, std::unique_ptr<crc32_shift_powers>> cache;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::unique_ptr<crc32_shift_powers>& entry = cache[generator];
+    if(!entry) {
+        entry.reset(new crc32_shift_powers);
+        const crc32_tables& tables = crc32_get_tables(generator);
+        // One zero byte: r -> (r >> 8) ^ T[r & 0xff]
+        for(int i = 0; i < 32; ++i) {
+            uint32_t r = 1U << i;
+            entry->pow[0].col[i] = (r >> 8) ^ tables.t[0][r & 0xff];
+        }
+        for(int k = 1; k < 64; ++k) {
+            crc32_matrix_square(entry->pow[k-1], entry->pow[k]);
+        }
+        if(crc32_invertible(generator)) {
+            uint8_t inverse[256];
+            crc32_build_inverse(tables, inverse);
+            for(int i = 0; i < 32; ++i) {
+                entry->inv_pow[0].col[i] = crc32_unshift_byte(1U << i, tables, inverse);
+            }
+            for(int k = 1; k < 64; ++k) {
+                crc32_matrix_square(entry->inv_pow[k-1], entry->inv_pow[k]);
+            }
+        }
+    }
+    return *entry;
+}
+
+uint32_t crc32_shift(uint32_t crc, uint64_t len, uint32_t generator) {
+    const crc32_shift_powers& powers = crc32_get_shift_powers(generator);
+    for(int k = 0; len != 0; ++k, len >>= 1) {
+        if(len & 1) {
+            crc = crc32_matrix_apply(powers.pow[k], crc);
+        }
+    }
+    return crc;
+}
+
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b, uint32_t generator) {
+    return crc32_shift(crc_a, len_b, generator) ^ crc_b;
+}
+
+bool crc32_invertible(uint32_t generator) {
+    // Bit 31 of a reflected generator is the x^0 term.
+    return (generator & 0x80000000U) != 0;
+}
+
+uint32_t crc32_unshift(uint32_t crc, uint64_t len, uint32_t generator) {
+    const crc32_shift_powers& powers = crc32_get_shift_powers(generator);
+    for(int k = 0; len != 0; ++k, len >>= 1) {
+        if(len & 1) {
+            crc = crc32_matrix_apply(powers.inv_pow[k], crc);
+        }
+    }
+    return crc;
+}
+
+void crc32_force(uint32_t from, uint32_t to, uint32_t generator, uint8_t bytes[4]) {
+    // Feeding bytes b from register r is feeding zeros from r ^ b, so step
+    // 'to' back over four zero bytes and the difference is the patch.
+    const crc32_tables& tables = crc32_get_tables(generator);
+    uint8_t inverse[256];
+    crc32_build_inverse(tables, inverse);
+    for(int i = 0; i < 4; ++i) {
+        to = crc32_unshift_byte(to, tables, inverse);
+    }
+    uint32_t patch = to ^ from;
+    for(int i = 0; i < 4; ++i) {
+        bytes[i] = (uint8_t)(patch >> (8*i));
+    }
+}
+
+crc_kernel crc32_resolve_kernel(crc_kernel kernel) {
+    if((kernel == crc_kernel::lanes)&&(crc32_lane_width() != 0)) {
+        return kernel;
+    }
+    if((kernel == crc_kernel::automatic)||(kernel == crc_kernel::clmul)||(kernel == crc_kernel::lanes)) {
+        return crc32_have_clmul() ? crc_kernel::clmul : crc_kernel::slice16;
+    }
+    return kernel;
+}
+
+uint32_t crc32_update(crc_kernel kernel, uint32_t crc, const uint8_t* data, size_t len, const crc32_tables& tables) {
+    if(kernel == crc_kernel::lanes) {
+        kernel = crc_kernel::automatic;
+    }
+    switch(crc32_resolve_kernel(kernel)) {
+        case crc_kernel::clmul:
+            return crc32_update_clmul(crc, data, len, tables);
+        case crc_kernel::slice8:
+            return crc32_update_slice8(crc, data, len, tables);
+        case crc_kernel::slice16:
+            return crc32_update_slice16(crc, data, len, tables);
+        case crc_kernel::bytewise:
+        default:
+            return crc32_update_bytewise(crc, data, len, tables);
+    }
+}
+
+const char* crc_kernel_name(crc_kernel kernel) {
+    switch(kernel) {
+        case crc_kernel::automatic:
+            return "auto";
+        case crc_kernel::bytewise:
+            return "byte";
+        case crc_kernel::slice8:
+            return "slice8";
+        case crc_kernel::slice16:
+            return "slice16";
+        case crc_kernel::clmul:
+            return "clmul";
+        case crc_kernel::lanes:
+            return "lanes";
+    }
+    return "unknown";
+}
+
+bool crc_kernel_from_name(const std::string& name, crc_kernel& kernel) {
+    if(name == "auto") {
+        kernel = crc_kernel::automatic;
+    } else if(name == "byte") {
+        kernel = crc_kernel::bytewise;
+    } else if(name == "slice8") {
+        kernel = crc_kernel::slice8;
+    } else if(name == "slice16") {
+        kernel = crc_kernel::slice16;
+    } else if(name == "clmul") {
+        kernel = crc_kernel::clmul;
+    } else if(name == "lanes") {
+        kernel = crc_kernel::lanes;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "crc32.h"
+
+// Lane parallel multi-generator kernels, see crc32_lane_set.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+// Entry of the base table for one generator.
+static uint32_t crc32_table_entry(uint32_t generator, uint32_t index) {
+    uint32_t rem = index;
+    for(int j = 0; j < 8; ++j) {
+        if(rem & 1) {
+            rem >>= 1;
+            rem ^= generator;
+        } else {
+            rem >>= 1;
+        }
+    }
+    return rem;
+}
+
+size_t crc32_lane_width() {
+    static const size_t width = __builtin_cpu_supports("avx512f") ? 16 : (__builtin_cpu_supports("avx2") ? 8 : 0);
+    return width;
+}
+
+void crc32_build_lane_set(const uint32_t* generators, size_t count, crc32_lane_set& set) {
+    set.count = count;
+    set.lanes = crc32_lane_width();
+    size_t groups = (count+set.lanes-1)/set.lanes;
+    // Unused lanes in the last group get an all zero basis.
+    set.basis.assign(groups*8*set.lanes, 0);
+    for(size_t g = 0; g < count; ++g) {
+        size_t group = g/set.lanes;
+        size_t lane = g%set.lanes;
+        for(int b = 0; b < 8; ++b) {
+            set.basis[(group*8+b)*set.lanes+lane] = crc32_table_entry(generators[g], 1U << b);
+        }
+    }
+}
+
+// GCC 12 flags the undefined pass-through operand inside _mm512_srli_epi32.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static void crc32_lanes_avx512(uint32_t* crcs, const uint32_t* basis, const uint8_t* data, size_t len) {
+    __m512i b[8];
+    for(int i = 0; i < 8; ++i) {
+        b[i] = _mm512_loadu_si512(basis+i*16);
+    }
+    __m512i crc = _mm512_loadu_si512(crcs);
+    for(size_t i = 0; i < len; ++i) {
+        crc = _mm512_xor_si512(crc, _mm512_set1_epi32(data[i]));
+        // Two accumulators to shorten the dependency chain.
+        __m512i a0 = _mm512_srli_epi32(crc, 8);
+        __m512i a1 = _mm512_setzero_si512();
+        a0 = _mm512_mask_xor_epi32(a0, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x01)), a0, b[0]);
+        a1 = _mm512_mask_xor_epi32(a1, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x02)), a1, b[1]);
+        a0 = _mm512_mask_xor_epi32(a0, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x04)), a0, b[2]);
+        a1 = _mm512_mask_xor_epi32(a1, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x08)), a1, b[3]);
+        a0 = _mm512_mask_xor_epi32(a0, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x10)), a0, b[4]);
+        a1 = _mm512_mask_xor_epi32(a1, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x20)), a1, b[5]);
+        a0 = _mm512_mask_xor_epi32(a0, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x40)), a0, b[6]);
+        a1 = _mm512_mask_xor_epi32(a1, _mm512_test_epi32_mask(crc, _mm512_set1_epi32(0x80)), a1, b[7]);
+        crc = _mm512_xor_si512(a0, a1);
+    }
+    _mm512_storeu_si512(crcs, crc);
+}
+#pragma GCC diagnostic pop
+
+// Broadcast bit 'bit' of every lane to a full lane mask and select the basis row.
+#define CRC32_LANE_SELECT_AVX2(crc, bit, row) _mm256_and_si256(_mm256_srai_epi32(_mm256_slli_epi32(crc, 31-(bit)), 31), row)
+
+__attribute__((target("avx2")))
+static void crc32_lanes_avx2(uint32_t* crcs, const uint32_t* basis, const uint8_t* data, size_t len) {
+    __m256i b[8];
+    for(int i = 0; i < 8; ++i) {
+        b[i] = _mm256_loadu_si256((const __m256i*)(basis+i*8));
+    }
+    __m256i crc = _mm256_loadu_si256((const __m256i*)crcs);
+    for(size_t i = 0; i < len; ++i) {
+        crc = _mm256_xor_si256(crc, _mm256_set1_epi32(data[i]));
+        __m256i a0 = _mm256_srli_epi32(crc, 8);
+        __m256i a1 = CRC32_LANE_SELECT_AVX2(crc, 1, b[1]);
+        a0 = _mm256_xor_si256(a0, CRC32_LANE_SELECT_AVX2(crc, 0, b[0]));
+        a0 = _mm256_xor_si256(a0, CRC32_LANE_SELECT_AVX2(crc, 2, b[2]));
+        a1 = _mm256_xor_si256(a1, CRC32_LANE_SELECT_AVX2(crc, 3, b[3]));
+        a0 = _mm256_xor_si256(a0, CRC32_LANE_SELECT_AVX2(crc, 4, b[4]));
+        a1 = _mm256_xor_si256(a1, CRC32_LANE_SELECT_AVX2(crc, 5, b[5]));
+        a0 = _mm256_xor_si256(a0, CRC32_LANE_SELECT_AVX2(crc, 6, b[6]));
+        a1 = _mm256_xor_si256(a1, CRC32_LANE_SELECT_AVX2(crc, 7, b[7]));
+        crc = _mm256_xor_si256(a0, a1);
+    }
+    _mm256_storeu_si256((__m256i*)crcs, crc);
+}
+
+void crc32_update_lanes(const crc32_lane_set& set, uint32_t* crcs, const uint8_t* data, size_t len) {
+    uint32_t group_crcs[16] = {0};
+    for(size_t base = 0; base < set.count; base += set.lanes) {
+        size_t used = std::min(set.lanes, set.count-base);
+        memcpy(group_crcs, crcs+base, used*sizeof(uint32_t));
+        const uint32_t* basis = set.basis.data()+(base/set.lanes)*8*set.lanes;
+        if(set.lanes == 16) {
+            crc32_lanes_avx512(group_crcs, basis, data, len);
+        } else {
+            crc32_lanes_avx2(group_crcs, basis, data, len);
+        }
+        memcpy(crcs+base, group_crcs, used*sizeof(uint32_t));
+    }
+}
+
+#else
+
+size_t crc32_lane_width() {
+    return 0;
+}
+
+void crc32_build_lane_set(const uint32_t* generators, size_t count, crc32_lane_set& set) {
+    (void)generators;
+    set.count = count;
+    set.lanes = 0;
+    set.basis.clear();
+}
+
+void crc32_update_lanes(const crc32_lane_set& set, uint32_t* crcs, const uint8_t* data, size_t len) {
+    (void)set;
+    (void)crcs;
+    (void)data;
+    (void)len;
+}
+
+#endif
@@ -0,0 +1,169 @@
+#include "crc_engine.h"
+
+crc_engine::crc_engine(const crc_model& model, crc_kernel kernel) : params(model), generic(nullptr), tables(nullptr), update_fn(nullptr) {
+    init_state = model.refin ? crc_reflect(model.init, model.width) : model.init;
+    summed = (model.algorithm == crc_algorithm::dword_sum);
+    if(summed) {
+        init_state = 0;
+    } else if((model.width == 32)&&model.refin) {
+        uint32_t generator = crc32_reflect32((uint32_t)model.poly);
+        tables = &crc32_get_tables(generator);
+        update_fn = crc32_select_update(kernel, generator);
+    } else {
+        generic = &crc_generic_get(model.width, model.refin, model.poly);
+    }
+    reset();
+}
+
+void crc_engine::update_zeros(uint64_t len) {
+    if(!summed) {
+        state = shift(state, len);
+    }
+    total += len;
+}
+
+void crc_engine::append(const crc_engine& tail) {
+    if(summed) {
+        dword_sum_append(sums, tail.sums, (unsigned)(total & 3));
+        total += tail.total;
+        return;
+    }
+    // tail.state = shift(init, n) ^ R0 where R0 is the register of its data started from zero.
+    state = shift(state ^ init_state, tail.total) ^ tail.state;
+    total += tail.total;
+}
+
+uint64_t crc_engine::apply_edits(uint64_t crc, uint64_t length, const std::vector<crc_edit>& edits) const {
+    if(summed) {
+        // Each changed byte moves the sum by its difference at its place in a dword.
+        uint32_t sum = (uint32_t)crc;
+        for(const crc_edit& edit : edits) {
+            for(size_t i = 0; i < edit.new_bytes.size(); ++i) {
+                unsigned place = 8*((edit.offset+i) & 3);
+                sum += ((uint32_t)edit.new_bytes[i] << place)-((uint32_t)edit.old_bytes[i] << place);
+            }
+        }
+        return sum;
+    }
+    // The register is affine in the message, so editing it xors in the
+    // register of the difference started from zero. A difference at offset
+    // is followed by length-offset-n zero bytes, which a shift covers.
+    uint64_t delta = 0;
+    std::vector<uint8_t> diff;
+    for(const crc_edit& edit : edits) {
+        size_t n = edit.new_bytes.size();
+        diff.resize(n);
+        for(size_t i = 0; i < n; ++i) {
+            diff[i] = edit.old_bytes[i]^edit.new_bytes[i];
+        }
+        uint64_t reg = (generic != nullptr) ? generic->update(0, diff.data(), n) : update_fn(0, diff.data(), n, *tables);
+        delta ^= shift(reg, length-edit.offset-n);
+    }
+    // Only the final reflection is left, xorout cancels.
+    return crc^((params.refin != params.refout) ? crc_reflect(delta, params.width) : delta);
+}
+
+// Rotate left by whole bytes.
+static uint32_t rotate_bytes(uint32_t v, unsigned bytes) {
+    unsigned bits = 8*(bytes & 3);
+    return (bits == 0) ? v : (v << bits)|(v >> (32-bits));
+}
+
+bool crc_engine::force(uint64_t crc, uint64_t length, uint64_t offset, const uint8_t old_bytes[4], uint64_t target, uint8_t new_bytes[4]) const {
+    if(summed) {
+        // Four bytes in a row fill each place of a dword once, so they add
+        // their own little endian value rotated to the offset's place.
+        uint32_t old_value = old_bytes[0]|(old_bytes[1] << 8)|(old_bytes[2] << 16)|((uint32_t)old_bytes[3] << 24);
+        uint32_t value = rotate_bytes((uint32_t)target-(uint32_t)crc+rotate_bytes(old_value, (unsigned)offset), 4-(unsigned)(offset & 3));
+        for(int i = 0; i < 4; ++i) {
+            new_bytes[i] = (uint8_t)(value >> (8*i));
+        }
+        return true;
+    }
+    if((generic != nullptr)||!crc32_invertible(tables->generator)) {
+        return false;
+    }
+    // As in apply_edits, the register difference the patch has to make,
+    // here moved back from the end of the message to just after the patch.
+    uint64_t delta = crc^target;
+    if(params.refin != params.refout) {
+        delta = crc_reflect(delta, params.width);
+    }
+    uint32_t reg = crc32_unshift((uint32_t)delta, length-offset-4, tables->generator);
+    uint8_t patch[4];
+    crc32_force(0, reg, tables->generator, patch);
+    for(int i = 0; i < 4; ++i) {
+        new_bytes[i] = old_bytes[i]^patch[i];
+    }
+    return true;
+}
+
+uint64_t crc_engine::shift(uint64_t reg, uint64_t len) const {
+    if(generic != nullptr) {
+        return crc_generic_shift(*generic, reg, len);
+    }
+    return crc32_shift((uint32_t)reg, len, tables->generator);
+}
+
+crc_engine_set::crc_engine_set(const std::vector<crc_model>& models, crc_kernel kernel) {
+    use_lanes = (crc32_resolve_kernel(kernel) == crc_kernel::lanes);
+    for(const crc_model& model : models) {
+        engines.emplace_back(model, kernel);
+        if(engines.back().tables == nullptr) {
+            use_lanes = false;
+        }
+    }
+    if(use_lanes) {
+        std::vector<uint32_t> generators;
+        for(const crc_engine& engine : engines) {
+            generators.push_back(engine.tables->generator);
+        }
+        crc32_build_lane_set(generators.data(), generators.size(), lane_set);
+        lane_states.resize(models.size());
+    }
+}
+
+void crc_engine_set::update(const uint8_t* data, size_t len) {
+    if(!use_lanes) {
+        for(crc_engine& engine : engines) {
+            engine.update(data, len);
+        }
+        return;
+    }
+
+    // Move the registers into the lanes and back.
+    for(size_t i = 0; i < engines.size(); ++i) {
+        lane_states[i] = (uint32_t)engines[i].state;
+    }
+    crc32_update_lanes(lane_set, lane_states.data(), data, len);
+    for(size_t i = 0; i < engines.size(); ++i) {
+        engines[i].state = lane_states[i];
+        engines[i].total += len;
+    }
+}
+
+void crc_engine_set::update_zeros(uint64_t len) {
+    for(crc_engine& engine : engines) {
+        engine.update_zeros(len);
+    }
+}
+
+void crc_engine_set::append(const crc_engine_set& tail) {
+    for(size_t i = 0; i < engines.size(); ++i) {
+        engines[i].append(tail.engines[i]);
+    }
+}
+
+std::vector<uint64_t> crc_engine_set::finalize() const {
+    std::vector<uint64_t> crcs;
+    for(const crc_engine& engine : engines) {
+        crcs.push_back(engine.finalize());
+    }
+    return crcs;
+}
+
+void crc_engine_set::reset() {
+    for(crc_engine& engine : engines) {
+        engine.reset();
+    }
+}
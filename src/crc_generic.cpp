@@ -0,0 +1,159 @@
+#include "crc_generic.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+uint64_t crc_reflect(uint64_t v, int width) {
+    uint64_t r = 0;
+    for(int i = 0; i < width; ++i) {
+        if(v & (1ULL << i)) {
+            r |= 1ULL << (width-1-i);
+        }
+    }
+    return r;
+}
+
+// t[k][v] is the register after byte v followed by k zero bytes, from zero.
+template<typename T, bool Reflected>
+struct crc_generic_tables {
+    T t[8][256];
+};
+
+template<typename T, bool Reflected>
+static void crc_generic_build(crc_generic_tables<T, Reflected>& tables, uint64_t poly) {
+    const int width = sizeof(T)*8;
+    const T generator = Reflected ? (T)crc_reflect(poly, width) : (T)poly;
+    const T top = (T)1 << (width-1);
+    for(int i = 0; i < 256; ++i) {
+        T rem;
+        if(Reflected) {
+            rem = (T)i;
+            for(int j = 0; j < 8; ++j) {
+                rem = (rem & 1) ? (T)((rem >> 1) ^ generator) : (T)(rem >> 1);
+            }
+        } else {
+            rem = (T)((T)i << (width-8));
+            for(int j = 0; j < 8; ++j) {
+                rem = (rem & top) ? (T)((T)(rem << 1) ^ generator) : (T)(rem << 1);
+            }
+        }
+        tables.t[0][i] = rem;
+    }
+    for(int k = 1; k < 8; ++k) {
+        for(int i = 0; i < 256; ++i) {
+            T prev = tables.t[k-1][i];
+            if(Reflected) {
+                tables.t[k][i] = (T)((width > 8 ? (prev >> 8) : 0) ^ tables.t[0][prev & 0xff]);
+            } else {
+                tables.t[k][i] = (T)((width > 8 ? (T)(prev << 8) : 0) ^ tables.t[0][(prev >> (width-8)) & 0xff]);
+            }
+        }
+    }
+}
+
+template<typename T, bool Reflected>
+static uint64_t crc_generic_update(uint64_t reg, const uint8_t* data, size_t len, const void* opaque) {
+    const int width = sizeof(T)*8;
+    const T (*t)[256] = ((const crc_generic_tables<T, Reflected>*)opaque)->t;
+    T crc = (T)reg;
+    while(len >= 8) {
+        // XOR the register into the leading bytes, then look every byte up
+        // in the table for its distance from the end of the 8 byte block.
+        uint8_t m[8];
+        for(int i = 0; i < 8; ++i) {
+            m[i] = data[i];
+        }
+        for(int i = 0; i < width/8; ++i) {
+            m[i] ^= Reflected ? (uint8_t)(crc >> (8*i)) : (uint8_t)(crc >> (width-8-8*i));
+        }
+        crc = (T)(t[7][m[0]] ^ t[6][m[1]] ^ t[5][m[2]] ^ t[4][m[3]] ^ t[3][m[4]] ^ t[2][m[5]] ^ t[1][m[6]] ^ t[0][m[7]]);
+        data += 8;
+        len -= 8;
+    }
+    for(size_t i = 0; i < len; ++i) {
+        if(Reflected) {
+            crc = (T)((width > 8 ? (crc >> 8) : 0) ^ t[0][(crc ^ data[i]) & 0xff]);
+        } else {
+            crc = (T)((width > 8 ? (T)(crc << 8) : 0) ^ t[0][((crc >> (width-8)) ^ data[i]) & 0xff]);
+        }
+    }
+    return crc;
+}
+
+// Cached kernel together with the powers of its zero byte operator.
+struct crc_generic_entry {
+    crc_generic_kernel kernel;
+    std::shared_ptr<void> tables;
+    uint64_t pow[64][64];
+};
+
+template<typename T, bool Reflected>
+static void crc_generic_fill(crc_generic_entry& entry, uint64_t poly) {
+    std::shared_ptr<crc_generic_tables<T, Reflected>> tables(new crc_generic_tables<T, Reflected>);
+    crc_generic_build<T, Reflected>(*tables, poly);
+    entry.tables = tables;
+    entry.kernel.tables = tables.get();
+    entry.kernel.update_fn = &crc_generic_update<T, Reflected>;
+}
+
+static uint64_t crc_matrix_apply(const uint64_t* m, uint64_t v) {
+    uint64_t r = 0;
+    for(int i = 0; v != 0; ++i, v >>= 1) {
+        if(v & 1) {
+            r ^= m[i];
+        }
+    }
+    return r;
+}
+
+const crc_generic_kernel& crc_generic_get(int width, bool reflected, uint64_t poly) {
+    static std::mutex cache_mutex;
+    static std::map<std::tuple<int, bool, uint64_t>, std::unique_ptr<crc_generic_entry>> cache;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::unique_ptr<crc_generic_entry>& entry = cache[std::make_tuple(width, reflected, poly)];
+    if(entry) {
+        return entry->kernel;
+    }
+
+    entry.reset(new crc_generic_entry);
+    entry->kernel.width = width;
+    entry->kernel.reflected = reflected;
+    entry->kernel.poly = poly;
+    entry->kernel.pow = entry->pow;
+    switch(width) {
+        case 8:
+            reflected ? crc_generic_fill<uint8_t, true>(*entry, poly) : crc_generic_fill<uint8_t, false>(*entry, poly);
+            break;
+        case 16:
+            reflected ? crc_generic_fill<uint16_t, true>(*entry, poly) : crc_generic_fill<uint16_t, false>(*entry, poly);
+            break;
+        case 32:
+            reflected ? crc_generic_fill<uint32_t, true>(*entry, poly) : crc_generic_fill<uint32_t, false>(*entry, poly);
+            break;
+        default:
+            reflected ? crc_generic_fill<uint64_t, true>(*entry, poly) : crc_generic_fill<uint64_t, false>(*entry, poly);
+            break;
+    }
+
+    const uint8_t zero = 0;
+    for(int i = 0; i < width; ++i) {
+        entry->pow[0][i] = entry->kernel.update(1ULL << i, &zero, 1);
+    }
+    for(int k = 1; k < 64; ++k) {
+        for(int i = 0; i < width; ++i) {
+            entry->pow[k][i] = crc_matrix_apply(entry->pow[k-1], entry->pow[k-1][i]);
+        }
+    }
+    return entry->kernel;
+}
+
+uint64_t crc_generic_shift(const crc_generic_kernel& kernel, uint64_t reg, uint64_t len) {
+    for(int k = 0; len != 0; ++k, len >>= 1) {
+        if(len & 1) {
+            reg = crc_matrix_apply(kernel.pow[k], reg);
+        }
+    }
+    return reg;
+}
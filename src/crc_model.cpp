@@ -0,0 +1,213 @@
+#include "crc_model.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include "crc32.h"
+#include "crc_engine.h"
+
+crc_model crc_sweep_model(uint32_t generator) {
+    return { "", 32, crc32_reflect32(generator), 0xFFFFFFFF, true, true, 0xFFFFFFFF, 0 };
+}
+
+// Parameters from the reveng CRC catalogue.
+const std::vector<crc_model>& crc_catalog() {
+    static const std::vector<crc_model> catalog = {
+        { "CRC-8/AUTOSAR", 8, 0x2f, 0xff, false, false, 0xff, 0xdf },
+        { "CRC-8/BLUETOOTH", 8, 0xa7, 0x00, true, true, 0x00, 0x26 },
+        { "CRC-8/CDMA2000", 8, 0x9b, 0xff, false, false, 0x00, 0xda },
+        { "CRC-8/DARC", 8, 0x39, 0x00, true, true, 0x00, 0x15 },
+        { "CRC-8/DVB-S2", 8, 0xd5, 0x00, false, false, 0x00, 0xbc },
+        { "CRC-8/I-432-1", 8, 0x07, 0x00, false, false, 0x55, 0xa1 },
+        { "CRC-8/I-CODE", 8, 0x1d, 0xfd, false, false, 0x00, 0x7e },
+        { "CRC-8/MAXIM-DOW", 8, 0x31, 0x00, true, true, 0x00, 0xa1 },
+        { "CRC-8/ROHC", 8, 0x07, 0xff, true, true, 0x00, 0xd0 },
+        { "CRC-8/SAE-J1850", 8, 0x1d, 0xff, false, false, 0xff, 0x4b },
+        { "CRC-8/SMBUS", 8, 0x07, 0x00, false, false, 0x00, 0xf4 },
+        { "CRC-8/TECH-3250", 8, 0x1d, 0xff, true, true, 0x00, 0x97 },
+        { "CRC-8/WCDMA", 8, 0x9b, 0x00, true, true, 0x00, 0x25 },
+
+        { "CRC-16/ARC", 16, 0x8005, 0x0000, true, true, 0x0000, 0xbb3d },
+        { "CRC-16/CDMA2000", 16, 0xc867, 0xffff, false, false, 0x0000, 0x4c06 },
+        { "CRC-16/CMS", 16, 0x8005, 0xffff, false, false, 0x0000, 0xaee7 },
+        { "CRC-16/DDS-110", 16, 0x8005, 0x800d, false, false, 0x0000, 0x9ecf },
+        { "CRC-16/DECT-R", 16, 0x0589, 0x0000, false, false, 0x0001, 0x007e },
+        { "CRC-16/DECT-X", 16, 0x0589, 0x0000, false, false, 0x0000, 0x007f },
+        { "CRC-16/DNP", 16, 0x3d65, 0x0000, true, true, 0xffff, 0xea82 },
+        { "CRC-16/EN-13757", 16, 0x3d65, 0x0000, false, false, 0xffff, 0xc2b7 },
+        { "CRC-16/GENIBUS", 16, 0x1021, 0xffff, false, false, 0xffff, 0xd64e },
+        { "CRC-16/GSM", 16, 0x1021, 0x0000, false, false, 0xffff, 0xce3c },
+        { "CRC-16/IBM-3740", 16, 0x1021, 0xffff, false, false, 0x0000, 0x29b1 },
+        { "CRC-16/IBM-SDLC", 16, 0x1021, 0xffff, true, true, 0xffff, 0x906e },
+        { "CRC-16/KERMIT", 16, 0x1021, 0x0000, true, true, 0x0000, 0x2189 },
+        { "CRC-16/LJ1200", 16, 0x6f63, 0x0000, false, false, 0x0000, 0xbdf4 },
+        { "CRC-16/M17", 16, 0x5935, 0xffff, false, false, 0x0000, 0x772b },
+        { "CRC-16/MAXIM-DOW", 16, 0x8005, 0x0000, true, true, 0xffff, 0x44c2 },
+        { "CRC-16/MCRF4XX", 16, 0x1021, 0xffff, true, true, 0x0000, 0x6f91 },
+        { "CRC-16/MODBUS", 16, 0x8005, 0xffff, true, true, 0x0000, 0x4b37 },
+        { "CRC-16/NRSC-5", 16, 0x080b, 0xffff, true, true, 0x0000, 0xa066 },
+        { "CRC-16/OPENSAFETY-A", 16, 0x5935, 0x0000, false, false, 0x0000, 0x5d38 },
+        { "CRC-16/OPENSAFETY-B", 16, 0x755b, 0x0000, false, false, 0x0000, 0x20fe },
+        { "CRC-16/PROFIBUS", 16, 0x1dcf, 0xffff, false, false, 0xffff, 0xa819 },
+        { "CRC-16/RIELLO", 16, 0x1021, 0xb2aa, true, true, 0x0000, 0x63d0 },
+        { "CRC-16/SPI-FUJITSU", 16, 0x1021, 0x1d0f, false, false, 0x0000, 0xe5cc },
+        { "CRC-16/T10-DIF", 16, 0x8bb7, 0x0000, false, false, 0x0000, 0xd0db },
+        { "CRC-16/TELEDISK", 16, 0xa097, 0x0000, false, false, 0x0000, 0x0fb3 },
+        { "CRC-16/TMS37157", 16, 0x1021, 0x89ec, true, true, 0x0000, 0x26b1 },
+        { "CRC-16/UMTS", 16, 0x8005, 0x0000, false, false, 0x0000, 0xfee8 },
+        { "CRC-16/USB", 16, 0x8005, 0xffff, true, true, 0xffff, 0xb4c8 },
+        { "CRC-16/XMODEM", 16, 0x1021, 0x0000, false, false, 0x0000, 0x31c3 },
+
+        { "CRC-32/AIXM", 32, 0x814141ab, 0x00000000, false, false, 0x00000000, 0x3010bf7f },
+        { "CRC-32/AUTOSAR", 32, 0xf4acfb13, 0xffffffff, true, true, 0xffffffff, 0x1697d06a },
+        { "CRC-32/BASE91-D", 32, 0xa833982b, 0xffffffff, true, true, 0xffffffff, 0x87315576 },
+        { "CRC-32/BZIP2", 32, 0x04c11db7, 0xffffffff, false, false, 0xffffffff, 0xfc891918 },
+        { "CRC-32/CD-ROM-EDC", 32, 0x8001801b, 0x00000000, true, true, 0x00000000, 0x6ec2edc4 },
+        { "CRC-32/CKSUM", 32, 0x04c11db7, 0x00000000, false, false, 0xffffffff, 0x765e7680 },
+        { "CRC-32/ISCSI", 32, 0x1edc6f41, 0xffffffff, true, true, 0xffffffff, 0xe3069283 },
+        { "CRC-32/ISO-HDLC", 32, 0x04c11db7, 0xffffffff, true, true, 0xffffffff, 0xcbf43926 },
+        { "CRC-32/JAMCRC", 32, 0x04c11db7, 0xffffffff, true, true, 0x00000000, 0x340bc6d9 },
+        { "CRC-32/MEF", 32, 0x741b8cd7, 0xffffffff, true, true, 0x00000000, 0xd2c22f51 },
+        { "CRC-32/MPEG-2", 32, 0x04c11db7, 0xffffffff, false, false, 0x00000000, 0x0376e6e7 },
+        { "CRC-32/XFER", 32, 0x000000af, 0x00000000, false, false, 0x00000000, 0xbd0be338 },
+
+        { "CRC-64/ECMA-182", 64, 0x42f0e1eba9ea3693, 0x0000000000000000, false, false, 0x0000000000000000, 0x6c40df5f0b497347 },
+        { "CRC-64/GO-ISO", 64, 0x000000000000001b, 0xffffffffffffffff, true, true, 0xffffffffffffffff, 0xb90956c775a41001 },
+        { "CRC-64/MS", 64, 0x259c84cba6426349, 0xffffffffffffffff, true, true, 0x0000000000000000, 0x75d4b74f024eceea },
+        { "CRC-64/NVME", 64, 0xad93d23594c93659, 0xffffffffffffffff, true, true, 0xffffffffffffffff, 0xae8b14860a799888 },
+        { "CRC-64/REDIS", 64, 0xad93d23594c935a9, 0x0000000000000000, true, true, 0x0000000000000000, 0xe9c6d914c4b8d9ca },
+        { "CRC-64/WE", 64, 0x42f0e1eba9ea3693, 0xffffffffffffffff, false, false, 0xffffffffffffffff, 0x62ec59e3f1a4f00a },
+        { "CRC-64/XZ", 64, 0x42f0e1eba9ea3693, 0xffffffffffffffff, true, true, 0xffffffffffffffff, 0x995dc9bbdf1939fa },
+
+        // The additive checksum some NE references give for the header field.
+        { "NE-SUM32", 32, 0, 0, false, false, 0, 0x6c6a689f, crc_algorithm::dword_sum },
+    };
+    return catalog;
+}
+
+struct crc_model_alias {
+    const char* alias;
+    const char* name;
+};
+
+static const crc_model_alias crc_model_aliases_list[] = {
+    { "CRC-8", "CRC-8/SMBUS" },
+    { "CRC-8/ITU", "CRC-8/I-432-1" },
+    { "CRC-8/MAXIM", "CRC-8/MAXIM-DOW" },
+    { "DOW-CRC", "CRC-8/MAXIM-DOW" },
+    { "CRC-8/EBU", "CRC-8/TECH-3250" },
+    { "CRC-8/AES", "CRC-8/TECH-3250" },
+    { "CRC-16", "CRC-16/ARC" },
+    { "ARC", "CRC-16/ARC" },
+    { "CRC-16/LHA", "CRC-16/ARC" },
+    { "CRC-16/BUYPASS", "CRC-16/UMTS" },
+    { "CRC-16/VERIFONE", "CRC-16/UMTS" },
+    { "CRC-16/CCITT-FALSE", "CRC-16/IBM-3740" },
+    { "CRC-16/AUTOSAR", "CRC-16/IBM-3740" },
+    { "CRC-16/CCITT", "CRC-16/KERMIT" },
+    { "CRC-16/CCITT-TRUE", "CRC-16/KERMIT" },
+    { "CRC-16/V-41-LSB", "CRC-16/KERMIT" },
+    { "CRC-16/ACORN", "CRC-16/XMODEM" },
+    { "CRC-16/LTE", "CRC-16/XMODEM" },
+    { "CRC-16/V-41-MSB", "CRC-16/XMODEM" },
+    { "ZMODEM", "CRC-16/XMODEM" },
+    { "CRC-16/X-25", "CRC-16/IBM-SDLC" },
+    { "CRC-16/ISO-HDLC", "CRC-16/IBM-SDLC" },
+    { "X-25", "CRC-16/IBM-SDLC" },
+    { "CRC-16/MAXIM", "CRC-16/MAXIM-DOW" },
+    { "CRC-16/DARC", "CRC-16/GENIBUS" },
+    { "CRC-16/EPC", "CRC-16/GENIBUS" },
+    { "CRC-16/I-CODE", "CRC-16/GENIBUS" },
+    { "CRC-16/AUG-CCITT", "CRC-16/SPI-FUJITSU" },
+    { "CRC-32", "CRC-32/ISO-HDLC" },
+    { "CRC-32/ADCCP", "CRC-32/ISO-HDLC" },
+    { "CRC-32/V-42", "CRC-32/ISO-HDLC" },
+    { "CRC-32/XZ", "CRC-32/ISO-HDLC" },
+    { "PKZIP", "CRC-32/ISO-HDLC" },
+    { "CRC-32C", "CRC-32/ISCSI" },
+    { "CRC-32/CASTAGNOLI", "CRC-32/ISCSI" },
+    { "CRC-32/INTERLAKEN", "CRC-32/ISCSI" },
+    { "CRC-32/AAL5", "CRC-32/BZIP2" },
+    { "CRC-32/DECT-B", "CRC-32/BZIP2" },
+    { "CRC-32/POSIX", "CRC-32/CKSUM" },
+    { "CKSUM", "CRC-32/CKSUM" },
+    { "JAMCRC", "CRC-32/JAMCRC" },
+    { "CRC-32Q", "CRC-32/AIXM" },
+    { "CRC-32D", "CRC-32/BASE91-D" },
+    { "XFER", "CRC-32/XFER" },
+    { "CRC-64", "CRC-64/ECMA-182" },
+    { "CRC-64/GO-ECMA", "CRC-64/XZ" },
+};
+
+static bool crc_name_equal(const std::string& a, const std::string& b) {
+    return (a.size() == b.size())&&std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::toupper((unsigned char)x) == std::toupper((unsigned char)y);
+    });
+}
+
+bool crc_model_from_name(const std::string& name, crc_model& model) {
+    std::string canonical = name;
+    for(const crc_model_alias& alias : crc_model_aliases_list) {
+        if(crc_name_equal(name, alias.alias)) {
+            canonical = alias.name;
+            break;
+        }
+    }
+    for(const crc_model& entry : crc_catalog()) {
+        if(crc_name_equal(canonical, entry.name)) {
+            model = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool crc_model_same_params(const crc_model& a, const crc_model& b) {
+    return (a.algorithm == b.algorithm)&&(a.width == b.width)&&(a.poly == b.poly)&&(a.init == b.init)&&(a.refin == b.refin)&&
+           (a.refout == b.refout)&&(a.xorout == b.xorout);
+}
+
+bool crc_model_lookup(crc_model& model) {
+    for(const crc_model& known : crc_catalog()) {
+        if(crc_model_same_params(known, model)) {
+            model.name = known.name;
+            model.check = known.check;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string crc_model_describe(const crc_model& model) {
+    std::ostringstream text;
+    if(model.algorithm == crc_algorithm::dword_sum) {
+        return "sum of little endian dwords";
+    }
+    text << "width=" << std::dec << model.width << std::hex << " poly=" << model.poly << " init=" << model.init
+         << " refin=" << (model.refin ? "true" : "false") << " refout=" << (model.refout ? "true" : "false") << " xorout=" << model.xorout;
+    return text.str();
+}
+
+std::string crc_model_aliases(const crc_model& model) {
+    std::string aliases;
+    for(const crc_model_alias& alias : crc_model_aliases_list) {
+        if(model.name == alias.name) {
+            if(!aliases.empty()) {
+                aliases += ", ";
+            }
+            aliases += alias.alias;
+        }
+    }
+    return aliases;
+}
+
+uint64_t crc_model_compute(const crc_model& model, const uint8_t* data, size_t len) {
+    crc_engine engine(model);
+    engine.update(data, len);
+    return engine.finalize();
+}
+
+bool crc_model_verify(const crc_model& model) {
+    static const uint8_t check_input[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    return crc_model_compute(model, check_input, sizeof(check_input)) == model.check;
+}
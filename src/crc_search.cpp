@@ -0,0 +1,141 @@
+#include "crc_search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <tuple>
+#include "crc32.h"
+
+// Polynomials handed to the lanes kernel per pass.
+#define CRC_SEARCH_BATCH 64
+
+// a*b mod x^32+P in normal bit order.
+static uint32_t crc_search_mulmod(uint32_t a, uint32_t b, uint32_t poly) {
+    uint32_t r = 0;
+    for(int i = 31; i >= 0; --i) {
+        r = (r & 0x80000000) ? ((r << 1) ^ poly) : (r << 1);
+        if(b & (1U << i)) {
+            r ^= a;
+        }
+    }
+    return r;
+}
+
+// x^n mod x^32+P by square and multiply.
+static uint32_t crc_search_xpow(uint64_t n, uint32_t poly) {
+    uint32_t r = 1;
+    for(int i = 63; i >= 0; --i) {
+        r = crc_search_mulmod(r, r, poly);
+        if(n & (1ULL << i)) {
+            r = (r & 0x80000000) ? ((r << 1) ^ poly) : (r << 1);
+        }
+    }
+    return r;
+}
+
+static uint8_t crc_search_reverse_byte(uint8_t b) {
+    b = (uint8_t)(((b & 0xf0) >> 4)|((b & 0x0f) << 4));
+    b = (uint8_t)(((b & 0xcc) >> 2)|((b & 0x33) << 2));
+    b = (uint8_t)(((b & 0xaa) >> 1)|((b & 0x55) << 1));
+    return b;
+}
+
+crc_search::crc_search(std::vector<uint8_t> input, uint32_t target) : data(std::move(input)), target(target) {
+    reversed.resize(data.size());
+    for(size_t i = 0; i < data.size(); ++i) {
+        reversed[i] = crc_search_reverse_byte(data[i]);
+    }
+}
+
+void crc_search::check_batch(const crc_search_space& space, const uint32_t* polys, size_t count, std::vector<crc_model>& matches) const {
+    std::vector<uint32_t> generators(count);
+    std::vector<uint32_t> xpow(count);
+    for(size_t i = 0; i < count; ++i) {
+        generators[i] = crc32_reflect32(polys[i]);
+        xpow[i] = crc_search_xpow(8*(uint64_t)data.size(), polys[i]);
+    }
+    crc32_lane_set lane_set;
+    bool use_lanes = (crc32_lane_width() != 0);
+    if(use_lanes) {
+        crc32_build_lane_set(generators.data(), count, lane_set);
+    }
+
+    for(int refin = 1; refin >= 0; --refin) {
+        const std::vector<uint8_t>& input = refin ? data : reversed;
+        std::vector<uint32_t> regs(count, 0);
+        if(use_lanes) {
+            crc32_update_lanes(lane_set, regs.data(), input.data(), input.size());
+        } else {
+            for(size_t i = 0; i < count; ++i) {
+                crc32_tables tables;
+                crc32_build_tables(generators[i], tables);
+                regs[i] = crc32_update_slice16(0, input.data(), input.size(), tables);
+            }
+        }
+
+        for(size_t i = 0; i < count; ++i) {
+            for(uint32_t init : space.inits) {
+                // Register after the data from init, in reflected order.
+                uint32_t reg = crc32_reflect32(crc_search_mulmod(init, xpow[i], polys[i])) ^ regs[i];
+                for(int refout = 1; refout >= 0; --refout) {
+                    uint32_t xorout = target ^ (refout ? reg : crc32_reflect32(reg));
+                    if(std::find(space.xorouts.begin(), space.xorouts.end(), xorout) != space.xorouts.end()) {
+                        matches.push_back({ "", 32, polys[i], init, refin != 0, refout != 0, xorout, 0 });
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<crc_model> crc_search::run(const crc_search_space& space, thread_pool& pool, const crc_search_progress_fn& progress) const {
+    // Odd polynomials in the range, as an index space.
+    uint32_t first = space.poly_first|1;
+    uint64_t total = (space.poly_last < first) ? 0 : ((uint64_t)(space.poly_last-first) >> 1)+1;
+    uint64_t batches = (total+CRC_SEARCH_BATCH-1)/CRC_SEARCH_BATCH;
+
+    std::atomic<uint64_t> next_batch(0);
+    std::atomic<uint64_t> polys_done(0);
+    std::mutex matches_mutex;
+    std::vector<crc_model> matches;
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t w = 0; w < pool.size(); ++w) {
+        pool.submit([&, first, total, batches] {
+            uint32_t polys[CRC_SEARCH_BATCH];
+            std::vector<crc_model> found;
+            for(uint64_t batch = next_batch++; batch < batches; batch = next_batch++) {
+                uint64_t index = batch*CRC_SEARCH_BATCH;
+                size_t count = (size_t)std::min<uint64_t>(CRC_SEARCH_BATCH, total-index);
+                for(size_t i = 0; i < count; ++i) {
+                    polys[i] = first+(uint32_t)(2*(index+i));
+                }
+                check_batch(space, polys, count, found);
+                polys_done += count;
+            }
+            std::lock_guard<std::mutex> lock(matches_mutex);
+            matches.insert(matches.end(), found.begin(), found.end());
+        });
+    }
+
+    auto report = [&] {
+        if(progress) {
+            uint64_t done = polys_done;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+            progress({ done, total, 2*done*(uint64_t)data.size(), seconds });
+        }
+    };
+    while(!pool.wait_for(std::chrono::milliseconds(1000))) {
+        report();
+    }
+    report();
+
+    std::sort(matches.begin(), matches.end(), [](const crc_model& a, const crc_model& b) {
+        return std::make_tuple(a.poly, !a.refin, !a.refout, a.init, a.xorout) < std::make_tuple(b.poly, !b.refin, !b.refout, b.init, b.xorout);
+    });
+    for(crc_model& match : matches) {
+        crc_model_lookup(match);
+    }
+    return matches;
+}
@@ -0,0 +1,74 @@
+#include "crc_solve.h"
+
+#include "crc32.h"
+
+// One equation: the unknown bits it involves and its right hand side.
+// Bits 0-31 are the initial register, bits 32-63 the final xor.
+struct crc_equation {
+    uint64_t row;
+    int rhs;
+};
+
+bool crc_solve_affine(uint32_t generator, bool refout, const std::vector<crc_sample>& samples, crc_solution& solution) {
+    std::vector<crc_equation> equations;
+    for(const crc_sample& sample : samples) {
+        crc32_matrix shift;
+        for(int k = 0; k < 32; ++k) {
+            shift.col[k] = crc32_shift(1U << k, sample.length, generator);
+        }
+        uint32_t value = (refout ? sample.stored : crc32_reflect32(sample.stored)) ^ sample.reg;
+        for(int j = 0; j < 32; ++j) {
+            uint64_t row = 1ULL << (32+j);
+            for(int k = 0; k < 32; ++k) {
+                if((shift.col[k] >> j) & 1) {
+                    row |= 1ULL << k;
+                }
+            }
+            equations.push_back({ row, (int)((value >> j) & 1) });
+        }
+    }
+
+    // Reduce to row echelon form, one pivot per unknown.
+    int pivot_row[64];
+    size_t rank = 0;
+    for(int bit = 0; bit < 64; ++bit) {
+        pivot_row[bit] = -1;
+        for(size_t r = rank; r < equations.size(); ++r) {
+            if(equations[r].row & (1ULL << bit)) {
+                std::swap(equations[r], equations[rank]);
+                break;
+            }
+        }
+        if((rank == equations.size())||!(equations[rank].row & (1ULL << bit))) {
+            continue;
+        }
+        for(size_t r = 0; r < equations.size(); ++r) {
+            if((r != rank)&&(equations[r].row & (1ULL << bit))) {
+                equations[r].row ^= equations[rank].row;
+                equations[r].rhs ^= equations[rank].rhs;
+            }
+        }
+        pivot_row[bit] = (int)rank;
+        ++rank;
+    }
+    // Left over rows read 0 = rhs.
+    for(size_t r = rank; r < equations.size(); ++r) {
+        if(equations[r].rhs) {
+            return false;
+        }
+    }
+
+    // Fully reduced, so with the free bits cleared each pivot is its rhs.
+    uint64_t unknowns = 0;
+    for(int bit = 0; bit < 64; ++bit) {
+        if((pivot_row[bit] >= 0)&&equations[pivot_row[bit]].rhs) {
+            unknowns |= 1ULL << bit;
+        }
+    }
+    uint32_t init_reg = (uint32_t)unknowns;
+    uint32_t xorout = (uint32_t)(unknowns >> 32);
+    solution.init = crc32_reflect32(init_reg);
+    solution.xorout = refout ? xorout : crc32_reflect32(xorout);
+    solution.free_bits = 64-(int)rank;
+    return true;
+}
@@ -0,0 +1,81 @@
+#include "dword_sum.h"
+#include "cpu_features.h"
+
+static void dword_sum_scalar(uint64_t lanes[4], const uint8_t* data, size_t len, unsigned phase) {
+    uint64_t sums[4] = {0};
+    size_t i = 0;
+    for(; i+4 <= len; i += 4) {
+        sums[0] += data[i];
+        sums[1] += data[i+1];
+        sums[2] += data[i+2];
+        sums[3] += data[i+3];
+    }
+    for(; i < len; ++i) {
+        sums[i & 3] += data[i];
+    }
+    for(unsigned j = 0; j < 4; ++j) {
+        lanes[(phase+j) & 3] += sums[j];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Each 32 byte block is split four ways by byte position under a mask and
+// each part summed with SAD against zero, which can't overflow the 64 bit
+// results for any input a process can hold.
+__attribute__((target("avx2")))
+static void dword_sum_avx2(uint64_t lanes[4], const uint8_t* data, size_t blocks, unsigned phase) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i masks[4], sums[4];
+    for(int j = 0; j < 4; ++j) {
+        masks[j] = _mm256_set1_epi32(0xff << (8*j));
+        sums[j] = zero;
+    }
+    for(size_t b = 0; b < blocks; ++b, data += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)data);
+        sums[0] = _mm256_add_epi64(sums[0], _mm256_sad_epu8(_mm256_and_si256(v, masks[0]), zero));
+        sums[1] = _mm256_add_epi64(sums[1], _mm256_sad_epu8(_mm256_and_si256(v, masks[1]), zero));
+        sums[2] = _mm256_add_epi64(sums[2], _mm256_sad_epu8(_mm256_and_si256(v, masks[2]), zero));
+        sums[3] = _mm256_add_epi64(sums[3], _mm256_sad_epu8(_mm256_and_si256(v, masks[3]), zero));
+    }
+    for(unsigned j = 0; j < 4; ++j) {
+        uint64_t parts[4];
+        _mm256_storeu_si256((__m256i*)parts, sums[j]);
+        lanes[(phase+j) & 3] += parts[0]+parts[1]+parts[2]+parts[3];
+    }
+}
+
+void dword_sum_update(uint64_t lanes[4], const uint8_t* data, size_t len, unsigned phase) {
+    if(!cpu_has_avx2()) {
+        dword_sum_scalar(lanes, data, len, phase);
+        return;
+    }
+    size_t blocks = len/32;
+    dword_sum_avx2(lanes, data, blocks, phase);
+    // 32 is a multiple of 4, so the tail keeps the same phase.
+    dword_sum_scalar(lanes, data+blocks*32, len-blocks*32, phase);
+}
+
+#else
+
+void dword_sum_update(uint64_t lanes[4], const uint8_t* data, size_t len, unsigned phase) {
+    dword_sum_scalar(lanes, data, len, phase);
+}
+
+#endif
+
+void dword_sum_append(uint64_t lanes[4], const uint64_t tail[4], unsigned phase) {
+    for(unsigned j = 0; j < 4; ++j) {
+        lanes[(phase+j) & 3] += tail[j];
+    }
+}
+
+uint32_t dword_sum_value(const uint64_t lanes[4]) {
+    uint64_t sum = 0;
+    for(unsigned j = 0; j < 4; ++j) {
+        sum += lanes[j] << (8*j);
+    }
+    return (uint32_t)sum;
+}
@@ -0,0 +1,107 @@
+#include "image_checksum.h"
+#include "cpu_features.h"
+
+static uint64_t image_sum_scalar(const uint8_t* data, size_t len) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i+1 < len; i += 2) {
+        sum += (uint64_t)(data[i]|(data[i+1] << 8));
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// 32 byte blocks per pass before the 32 bit lanes are widened. Each block
+// adds at most 0xffff to a lane of one accumulator, so the four of them
+// summed stay below 2^31.
+#define IMAGE_SUM_AVX2_PASS 0x4000
+
+// Sum the words of the 32 byte blocks of data. Even words land in the low
+// halves of the 32 bit lanes and odd words in the high halves, which are
+// summed apart and widened to 64 bits once a pass.
+__attribute__((target("avx2")))
+static uint64_t image_sum_avx2(const uint8_t* data, size_t blocks) {
+    const __m256i low_words = _mm256_set1_epi32(0xffff);
+    const __m256i low_dwords = _mm256_set1_epi64x(0xffffffff);
+    __m256i total = _mm256_setzero_si256();
+    while(blocks != 0) {
+        size_t pass = (blocks < IMAGE_SUM_AVX2_PASS) ? blocks : IMAGE_SUM_AVX2_PASS;
+        blocks -= pass;
+        __m256i even0 = _mm256_setzero_si256(), odd0 = _mm256_setzero_si256();
+        __m256i even1 = _mm256_setzero_si256(), odd1 = _mm256_setzero_si256();
+        size_t i = 0;
+        for(; i+2 <= pass; i += 2, data += 64) {
+            __m256i v0 = _mm256_loadu_si256((const __m256i*)data);
+            __m256i v1 = _mm256_loadu_si256((const __m256i*)(data+32));
+            even0 = _mm256_add_epi32(even0, _mm256_and_si256(v0, low_words));
+            odd0 = _mm256_add_epi32(odd0, _mm256_srli_epi32(v0, 16));
+            even1 = _mm256_add_epi32(even1, _mm256_and_si256(v1, low_words));
+            odd1 = _mm256_add_epi32(odd1, _mm256_srli_epi32(v1, 16));
+        }
+        if(i < pass) {
+            __m256i v0 = _mm256_loadu_si256((const __m256i*)data);
+            even0 = _mm256_add_epi32(even0, _mm256_and_si256(v0, low_words));
+            odd0 = _mm256_add_epi32(odd0, _mm256_srli_epi32(v0, 16));
+            data += 32;
+        }
+        __m256i lanes = _mm256_add_epi32(_mm256_add_epi32(even0, even1), _mm256_add_epi32(odd0, odd1));
+        total = _mm256_add_epi64(total, _mm256_and_si256(lanes, low_dwords));
+        total = _mm256_add_epi64(total, _mm256_srli_epi64(lanes, 32));
+    }
+    uint64_t parts[4];
+    _mm256_storeu_si256((__m256i*)parts, total);
+    return parts[0]+parts[1]+parts[2]+parts[3];
+}
+
+// Sum of the words of an even number of bytes.
+static uint64_t image_sum_words(const uint8_t* data, size_t len) {
+    if(!cpu_has_avx2()) {
+        return image_sum_scalar(data, len);
+    }
+    size_t blocks = len/32;
+    return image_sum_avx2(data, blocks)+image_sum_scalar(data+blocks*32, len-blocks*32);
+}
+
+#else
+
+static uint64_t image_sum_words(const uint8_t* data, size_t len) {
+    return image_sum_scalar(data, len);
+}
+
+#endif
+
+uint64_t image_sum_update(uint64_t sum, const uint8_t* data, size_t len, uint64_t offset) {
+    if(len == 0) {
+        return sum;
+    }
+    if(offset & 1) {
+        sum += (uint64_t)data[0] << 8;
+        ++data;
+        --len;
+    }
+    sum += image_sum_words(data, len & ~(size_t)1);
+    if(len & 1) {
+        sum += data[len-1];
+    }
+    return sum;
+}
+
+uint32_t image_checksum_finish(uint64_t sum, uint64_t file_length, uint32_t stored_checksum) {
+    while(sum >> 16) {
+        sum = (sum & 0xffff)+(sum >> 16);
+    }
+    // Take the stored checksum back out a word at a time, exactly as
+    // imagehlp does, including its off by one when a word borrows.
+    uint32_t calc = (uint32_t)sum;
+    uint32_t words[2] = { stored_checksum & 0xffff, stored_checksum >> 16 };
+    for(uint32_t word : words) {
+        if((calc & 0xffff) >= word) {
+            calc -= word;
+        } else {
+            calc = (((calc & 0xffff)-word) & 0xffff)-1;
+        }
+    }
+    return calc+(uint32_t)file_length;
+}
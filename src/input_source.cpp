@@ -0,0 +1,123 @@
+#include "input_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+input_source::~input_source() {
+    close();
+}
+
+bool input_source::open(const std::string& path, input_mode mode, std::string& error, unsigned queue_depth) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        error = std::string("Couldn't open ")+path+": "+strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        error = "Couldn't get the size of the input file!";
+        close();
+        return false;
+    }
+    file_size = info.st_size;
+
+    if(mode == input_mode::uring) {
+        uring_depth = queue_depth;
+        use_uring = true;
+        use_uring = (thread_ring() != nullptr);
+        return true;
+    }
+
+    // Empty files can't be mapped and need no reads.
+    if((mode != input_mode::pread)&&S_ISREG(info.st_mode)&&(file_size != 0)) {
+        void* p = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) {
+            mapping = (const uint8_t*)p;
+            madvise(p, file_size, MADV_SEQUENTIAL);
+            madvise(p, file_size, MADV_WILLNEED);
+        }
+    }
+    if((mode == input_mode::mmap)&&(mapping == nullptr)&&(file_size != 0)) {
+        error = std::string("Couldn't map ")+path+": "+strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void input_source::close() {
+    if(mapping != nullptr) {
+        munmap((void*)mapping, file_size);
+        mapping = nullptr;
+    }
+    if(fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    file_size = 0;
+    use_uring = false;
+}
+
+const char* input_source::reader_name() const {
+    if(mapping != nullptr) {
+        return "mmap";
+    }
+    return use_uring ? "uring" : "pread";
+}
+
+uring_reader* input_source::thread_ring() const {
+    // One ring per thread, reused across files while the depth stays the same.
+    thread_local uring_reader ring;
+    thread_local bool unavailable = false;
+    if(unavailable) {
+        return nullptr;
+    }
+    if(!ring.ready()||(ring.depth() != uring_depth)) {
+        if(!ring.init(uring_depth, INPUT_READ_SIZE)) {
+            unavailable = true;
+            return nullptr;
+        }
+    }
+    return &ring;
+}
+
+bool input_source::read_at(uint64_t offset, uint8_t* data, size_t len, size_t& got) const {
+    got = 0;
+    while(got < len) {
+        ssize_t n = pread(fd, data+got, len-got, offset+got);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if(n == 0) {
+            break;
+        }
+        got += n;
+    }
+    return true;
+}
+
+bool input_source::view(uint64_t offset, size_t len, std::vector<uint8_t>& scratch, const uint8_t*& data, size_t& got) const {
+    if(offset >= file_size) {
+        data = nullptr;
+        got = 0;
+        return true;
+    }
+    len = (size_t)std::min<uint64_t>(len, file_size-offset);
+    if(mapping != nullptr) {
+        data = mapping+offset;
+        got = len;
+        return true;
+    }
+    scratch.resize(len);
+    data = scratch.data();
+    return read_at(offset, scratch.data(), len, got);
+}
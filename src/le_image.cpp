@@ -0,0 +1,62 @@
+#include "le_image.h"
+#include <algorithm>
+
+bool le_image::parse(const uint8_t* image, size_t image_size, std::string& error) {
+    data = image;
+    size = image_size;
+    if((size < MZ_HEADER_SIZE)||(data[0] != 'M')||(data[1] != 'Z')) {
+        error = "This is not a valid microsoft binary!";
+        return false;
+    }
+    le_offset = load_le32(data+MZ_LFANEW);
+    if(!contains(le_offset, LE_HEADER_SIZE)||(data[le_offset] != 'L')||((data[le_offset+1] != 'E')&&(data[le_offset+1] != 'X'))) {
+        error = "This is not an LE or LX binary!";
+        return false;
+    }
+    header = data+le_offset;
+    // Byte and word order.
+    if((header[2] != 0)||(header[3] != 0)) {
+        error = "Big endian LE and LX images aren't supported!";
+        return false;
+    }
+    if(lx() ? (page_shift() > 31) : (page_size() == 0)) {
+        error = "Malformed LE header!";
+        return false;
+    }
+    return true;
+}
+
+bool le_image::page_checksum(uint32_t index, uint32_t& checksum) const {
+    if((load_le32(header+0x7c) == 0)||(index == 0)||(index > page_count())) {
+        return false;
+    }
+    uint64_t offset = table(0x7c)+(uint64_t)(index-1)*4;
+    if(!contains(offset, 4)) {
+        return false;
+    }
+    checksum = load_le32(data+offset);
+    return true;
+}
+
+bool le_image::image_end(uint64_t& end) const {
+    end = (uint64_t)le_offset+LE_HEADER_SIZE;
+    end = std::max<uint64_t>(end, loader_section_offset()+loader_section_size());
+    end = std::max<uint64_t>(end, fixup_section_offset()+fixup_section_size());
+    // The non-resident names and debug information are placed from the
+    // start of the file.
+    uint32_t nonresident_offset = load_le32(header+0x88);
+    if(nonresident_offset != 0) {
+        end = std::max<uint64_t>(end, (uint64_t)nonresident_offset+load_le32(header+0x8c));
+    }
+    uint32_t debug_offset = load_le32(header+0x98);
+    if(debug_offset != 0) {
+        end = std::max<uint64_t>(end, (uint64_t)debug_offset+load_le32(header+0x9c));
+    }
+    bool pages_ok = true;
+    bool ok = for_each_object([&](const le_object& object) {
+        pages_ok = for_each_page(object, [&](const le_page& page) {
+            end = std::max<uint64_t>(end, page.file_offset+page.file_length);
+        })&&pages_ok;
+    });
+    return ok&&pages_ok;
+}
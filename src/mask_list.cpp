@@ -0,0 +1,67 @@
+#include "mask_list.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+void mask_list::add(uint64_t offset, uint64_t length, mask_mode mode, const std::string& label) {
+    if(length == 0) {
+        return;
+    }
+    std::vector<mask_range> ranges = sorted;
+    ranges.push_back({offset, length, mode, label});
+
+    // Split at every range boundary and give each piece the strongest mode covering it.
+    std::vector<uint64_t> bounds;
+    for(const mask_range& range : ranges) {
+        bounds.push_back(range.offset);
+        bounds.push_back(range.end());
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    sorted.clear();
+    for(size_t b = 0; b+1 < bounds.size(); ++b) {
+        const mask_range* cover = nullptr;
+        for(const mask_range& range : ranges) {
+            if((range.offset <= bounds[b])&&(range.end() >= bounds[b+1])) {
+                if((cover == nullptr)||((range.mode == mask_mode::exclude)&&(cover->mode == mask_mode::zero))) {
+                    cover = &range;
+                }
+            }
+        }
+        if(cover == nullptr) {
+            continue;
+        }
+        // Merge with the previous piece when it continues the same range.
+        if(!sorted.empty()&&(sorted.back().end() == bounds[b])&&(sorted.back().mode == cover->mode)&&(sorted.back().label == cover->label)) {
+            sorted.back().length += bounds[b+1]-bounds[b];
+        } else {
+            sorted.push_back({bounds[b], bounds[b+1]-bounds[b], cover->mode, cover->label});
+        }
+    }
+}
+
+size_t mask_list::first_after(uint64_t offset) const {
+    auto it = std::upper_bound(sorted.begin(), sorted.end(), offset, [](uint64_t o, const mask_range& range) { return o < range.end(); });
+    return it-sorted.begin();
+}
+
+bool parse_mask_range(const std::string& text, uint64_t& offset, uint64_t& length) {
+    size_t colon = text.find(':');
+    if(colon == std::string::npos) {
+        return false;
+    }
+    std::string offset_text = text.substr(0, colon);
+    std::string length_text = text.substr(colon+1);
+    char* end = nullptr;
+    offset = strtoull(offset_text.c_str(), &end, 0);
+    if(offset_text.empty()||(*end != '\0')) {
+        return false;
+    }
+    length = strtoull(length_text.c_str(), &end, 0);
+    if(length_text.empty()||(*end != '\0')) {
+        return false;
+    }
+    // The list is kept sorted by end, which mustn't wrap.
+    return length <= UINT64_MAX-offset;
+}
@@ -1,71 +1,1951 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include "ArgParseStandalone.h"
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cctype>
+#include <iomanip>
 #include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "crc32.h"
+#include "crc_engine.h"
+#include "crc_model.h"
+#include "crc_search.h"
+#include "crc_solve.h"
+#include "input_source.h"
+#include "mask_list.h"
+#include "ne_image.h"
+#include "pe_image.h"
+#include "le_image.h"
+#include "mz_scan.h"
+#include "cpu_features.h"
+#include "image_checksum.h"
+#include "thread_pool.h"
 
 // CRC32 implementation from: https://rosettacode.org/wiki/CRC-32#C 
 #define BUFFER_SIZE 1024
 
-uint32_t rc_crc32(FILE* the_file, char* buf, size_t word_loc, uint32_t generator) {
-    uint32_t table[256];
-    //static bool have_table = false;
-    uint32_t rem = 0;
-    uint8_t octet = 0;
-
-    /* Calculate CRC table. */
-    for(int i = 0; i < 256; i++) {
-        rem = i; /* remainder from polynomial division */
-        for(int j = 0; j < 8; ++j) {
-            if(rem & 1) {
-                rem >>= 1;
-                rem ^= generator;
-            } else {
-                rem >>= 1;
+// Bytes handed to every generator at once, small enough to stay in L1.
+#define CRC_BLOCK_SIZE (16*1024)
+
+// A masked byte, reported on the debug channel.
+struct masked_byte {
+    uint64_t offset;
+    uint8_t value;
+    const mask_range* range;
+};
+
+static void collect_masked(const mask_list& mask, const uint8_t* buf, size_t num_bytes, uint64_t buff_base, std::vector<masked_byte>& masked) {
+    mask.for_each_masked(buf, num_bytes, buff_base, [&masked](const mask_range& range, uint64_t offset, uint8_t value) {
+        masked.push_back({offset, value, &range});
+    });
+}
+
+static void print_masked(const std::vector<masked_byte>& masked, std::ostream& err) {
+    for(const masked_byte& m : masked) {
+        err << (m.range->mode == mask_mode::zero ? "Overriding" : "Excluding") << " byte " << std::hex << m.offset << " = " << (uint16_t)m.value << std::dec << " (" << m.range->label << ")" << std::endl;
+    }
+}
+
+// 16 bit word sums of the unmasked bytes, taken in the same pass as the
+// CRCs: the whole file for the PE image checksum and the DOS image for the
+// MZ e_csum.
+struct word_sums {
+    bool image = false;
+    uint64_t dos_size = 0;
+    uint64_t image_sum = 0;
+    uint64_t dos_sum = 0;
+
+    void update(const uint8_t* data, size_t len, uint64_t offset) {
+        if(image) {
+            image_sum = image_sum_update(image_sum, data, len, offset);
+        }
+        if(offset < dos_size) {
+            dos_sum = image_sum_update(dos_sum, data, (size_t)std::min<uint64_t>(len, dos_size-offset), offset);
+        }
+    }
+    // The same sums over another piece of the file, nothing added yet.
+    word_sums piece() const {
+        word_sums sums = *this;
+        sums.image_sum = sums.dos_sum = 0;
+        return sums;
+    }
+    // Add a piece's sums, pieces can come in any order.
+    void append(const word_sums& sums) {
+        image_sum += sums.image_sum;
+        dos_sum += sums.dos_sum;
+    }
+};
+
+// Feed the whole file through the engines in a single pass.
+// Each block is read once and all the CRC states are advanced over it.
+// With sums the unmasked bytes are also added to the word sums.
+bool rc_crc32(const input_source& source, const mask_list& mask, crc_engine_set& engines, bool debug, std::ostream& err, word_sums* sums = nullptr) {
+    std::vector<masked_byte> masked;
+    bool ok = source.for_each_block(0, source.size(), CRC_BLOCK_SIZE, [&](const uint8_t* data, size_t num_bytes, uint64_t buff_base) {
+        if(sums != nullptr) {
+            sums->update(data, num_bytes, buff_base);
+        }
+        if(debug) {
+            masked.clear();
+            collect_masked(mask, data, num_bytes, buff_base, masked);
+            print_masked(masked, err);
+        }
+        mask.feed(engines, data, num_bytes, buff_base);
+    });
+    if(!ok) {
+        err << "There was a problem reading the input file!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Sink collecting the checksummed stream in memory.
+struct masked_stream {
+    std::vector<uint8_t> bytes;
+
+    void update(const uint8_t* data, size_t len) {
+        bytes.insert(bytes.end(), data, data+len);
+    }
+    void update_zeros(uint64_t len) {
+        bytes.resize(bytes.size()+len, 0);
+    }
+};
+
+// Read the whole file with the mask applied, as the engines would see it.
+bool load_masked(const input_source& source, const mask_list& mask, std::vector<uint8_t>& stream) {
+    masked_stream sink;
+    sink.bytes.reserve(source.size());
+    if(!source.for_each_block(0, source.size(), CRC_BLOCK_SIZE, [&](const uint8_t* data, size_t num_bytes, uint64_t buff_base) {
+        mask.feed(sink, data, num_bytes, buff_base);
+    })) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return false;
+    }
+    stream.swap(sink.bytes);
+    return true;
+}
+
+// Parse a 32 bit hex value, with or without 0x.
+static bool parse_hex32(const std::string& text, uint32_t& value) {
+    char* end = nullptr;
+    unsigned long long parsed = strtoull(text.c_str(), &end, 16);
+    if((end == text.c_str())||(*end != '\0')||(parsed > 0xFFFFFFFFULL)) {
+        return false;
+    }
+    value = (uint32_t)parsed;
+    return true;
+}
+
+// Search the model space for the stored CRC and print every match.
+int search_models(const input_source& source, const mask_list& mask, uint32_t stored_crc, const crc_search_space& space, size_t threads) {
+    std::vector<uint8_t> stream;
+    if(!load_masked(source, mask, stream)) {
+        return 1;
+    }
+    std::cerr << "Searching for " << std::hex << stored_crc << " over " << std::dec << stream.size() << " bytes" << std::endl;
+    crc_search search(std::move(stream), stored_crc);
+    thread_pool pool(threads);
+    std::vector<crc_model> matches = search.run(space, pool, [](const crc_search_progress& p) {
+        double rate = p.seconds > 0 ? p.polys_done/p.seconds : 0;
+        double gbps = p.seconds > 0 ? p.bytes_done/p.seconds/1e9 : 0;
+        std::cerr << std::dec << "Searched " << p.polys_done << "/" << p.polys_total << " polynomials, " << (uint64_t)rate << " polys/s, " << gbps << " GB/s" << std::endl;
+    });
+    for(const crc_model& match : matches) {
+        std::cout << "Match: " << crc_model_describe(match);
+        if(!match.name.empty()) {
+            std::cout << " (" << match.name << ")";
+        }
+        std::cout << std::endl;
+    }
+    if(matches.empty()) {
+        std::cout << "No matching models" << std::endl;
+    }
+    return 0;
+}
+
+// Result of one chunk of rc_crc32_chunked.
+struct crc_chunk {
+    uint64_t offset;
+    uint64_t length;
+    crc_engine_set engines;
+    std::vector<masked_byte> masked;
+    word_sums sums;
+    bool ok;
+};
+
+// Feed [chunk.offset, chunk.offset+chunk.length) through the chunk's engines.
+static void crc_one_chunk(const input_source& source, const mask_list& mask, bool debug, crc_chunk& chunk) {
+    chunk.ok = source.for_each_block(chunk.offset, chunk.length, CRC_BLOCK_SIZE, [&](const uint8_t* data, size_t num_bytes, uint64_t pos) {
+        chunk.sums.update(data, num_bytes, pos);
+        if(debug) {
+            collect_masked(mask, data, num_bytes, pos, chunk.masked);
+        }
+        mask.feed(chunk.engines, data, num_bytes, pos);
+    });
+}
+
+// Split the file into chunks, feed each chunk through its own copy of the
+// engines on the pool and append them in order. Gives the same results as rc_crc32.
+bool rc_crc32_chunked(const input_source& source, const mask_list& mask, crc_engine_set& engines, thread_pool& pool, uint64_t chunk_size, bool debug,
+                      std::ostream& err, word_sums* sums = nullptr) {
+    uint64_t file_size = source.size();
+    std::vector<crc_chunk> chunks;
+    for(uint64_t offset = 0; offset < file_size; offset += chunk_size) {
+        crc_chunk chunk = { offset, std::min(chunk_size, file_size-offset), engines.clone(), {}, (sums != nullptr) ? sums->piece() : word_sums(), false };
+        chunk.engines.reset();
+        chunks.push_back(chunk);
+    }
+
+    for(crc_chunk& chunk : chunks) {
+        crc_chunk* c = &chunk;
+        pool.submit([&source, &mask, debug, c] { crc_one_chunk(source, mask, debug, *c); });
+    }
+    pool.wait();
+
+    for(const crc_chunk& chunk : chunks) {
+        if(!chunk.ok) {
+            err << "There was a problem reading the input file!" << std::endl;
+            return false;
+        }
+        print_masked(chunk.masked, err);
+        engines.append(chunk.engines);
+        if(sums != nullptr) {
+            sums->append(chunk.sums);
+        }
+    }
+    return true;
+}
+
+// Time each kernel over the whole input and report the throughput.
+// The lanes kernel is timed over all the generators and reported per model byte.
+int bench_kernels(const input_source& source, const std::vector<uint32_t>& generators) {
+    std::vector<uint8_t> scratch;
+    const uint8_t* bytes;
+    size_t num_bytes;
+    if(!source.view(0, source.size(), scratch, bytes, num_bytes)) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return 1;
+    }
+    if(num_bytes == 0) {
+        std::cerr << "Nothing to benchmark!" << std::endl;
+        return 1;
+    }
+    byte_span data = { bytes, num_bytes };
+
+    const crc32_tables& tables = crc32_get_tables(0xEDB88320);
+
+    // Repeat small inputs so each measurement covers a reasonable amount of data.
+    const size_t min_total = 256*1024*1024;
+    size_t reps = (min_total+data.size-1)/data.size;
+    // GB/s of pass run runs times, each covering bytes of input.
+    auto measure = [](size_t runs, double bytes, auto pass) {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t r = 0; r < runs; ++r) {
+            pass();
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        return (bytes*runs)/seconds/1e9;
+    };
+    const crc_kernel kernels[] = { crc_kernel::bytewise, crc_kernel::slice8, crc_kernel::slice16, crc_kernel::clmul };
+    for(crc_kernel kernel : kernels) {
+        if(crc32_resolve_kernel(kernel) != kernel) {
+            // Not supported on this CPU.
+            continue;
+        }
+        uint32_t crc = 0;
+        double gbps = measure(reps, data.size, [&] {
+            crc = ~crc32_update(kernel, ~0U, data.data, data.size, tables);
+        });
+        std::cout << "Kernel: " << crc_kernel_name(kernel) << " -> " << std::hex << crc << std::dec << " " << gbps << " GB/s" << std::endl;
+    }
+
+    {
+        uint64_t sum = 0;
+        double gbps = measure(reps, data.size, [&] {
+            sum = image_sum_update(sum, data.data, data.size, 0);
+        });
+        std::cout << "Kernel: image checksum " << avx2_kernel_name() << " -> " << std::hex << image_checksum_finish(sum, data.size, 0) << std::dec
+                  << " " << gbps << " GB/s" << std::endl;
+    }
+    {
+        uint64_t lanes[4] = {0};
+        double gbps = measure(reps, data.size, [&] {
+            dword_sum_update(lanes, data.data, data.size, 0);
+        });
+        std::cout << "Kernel: dword sum " << avx2_kernel_name() << " -> " << std::hex << dword_sum_value(lanes) << std::dec << " " << gbps << " GB/s" << std::endl;
+    }
+    {
+        std::vector<uint64_t> hits;
+        double gbps = measure(reps, data.size, [&] {
+            hits.clear();
+            mz_scan(data.data, data.size, 0, hits);
+        });
+        std::cout << "Kernel: mz scan " << avx2_kernel_name() << " -> " << std::dec << hits.size() << " " << gbps << " GB/s" << std::endl;
+    }
+
+    if((crc32_lane_width() != 0)&&!generators.empty()) {
+        crc32_lane_set lane_set;
+        crc32_build_lane_set(generators.data(), generators.size(), lane_set);
+        std::vector<uint32_t> crcs(generators.size());
+        size_t lane_reps = (reps+generators.size()-1)/generators.size();
+        double gbps = measure(lane_reps, (double)data.size*generators.size(), [&] {
+            crcs.assign(generators.size(), ~0U);
+            crc32_update_lanes(lane_set, crcs.data(), data.data, data.size);
+        });
+        std::cout << "Kernel: lanes x" << std::dec << lane_set.lanes << " (" << generators.size() << " generators) " << gbps << " GB/s" << std::endl;
+    }
+    return 0;
+}
+
+// Which checksum field an input carries.
+enum class image_format {
+    ne, // 32 bit CRC in the NE header
+    pe, // image checksum in the PE optional header
+    le, // none, LE and LX only checksum pages and sections
+};
+
+// Open an NE, PE, LE or LX binary and find its checksum field, the NE CRC or
+// the PE CheckSum. An LE or LX image has neither, its field_location and
+// stored_value are 0. Returns false after reporting any problem.
+bool open_image(const std::string& input_filepath, input_mode mode, unsigned queue_depth, input_source& source, image_format& format,
+                uint32_t& field_location, uint32_t& stored_value, std::ostream& err) {
+    if(access(input_filepath.c_str(), F_OK) == -1) {
+        err << "The input file " << input_filepath << " doesn't exist!" << std::endl;
+        return false;
+    }
+    
+    // Open the input file for reading.
+    std::string error;
+    if(!source.open(input_filepath, mode, error, queue_depth)) {
+        err << error << std::endl;
+        return false;
+    }
+
+    // Read header info.
+    std::vector<uint8_t> scratch;
+    const uint8_t* buf;
+    size_t num_bytes;
+    if(!source.view(0, BUFFER_SIZE, scratch, buf, num_bytes)||(num_bytes == 0)) {
+        err << "There was a problem reading the input file!" << std::endl;
+        return false;
+    }
+
+    // Check that this is a microsoft binary
+    if((num_bytes < MZ_HEADER_SIZE)||(buf[0] != 'M')||(buf[1] != 'Z')) {
+        err << "This is not a valid microsoft binary!" << std::endl;
+        return false;
+    }
+
+    uint32_t new_header_location = load_le32(buf+MZ_LFANEW);
+
+    // Read the new header in place
+    if(!source.view(new_header_location, BUFFER_SIZE, scratch, buf, num_bytes)||(num_bytes < 0xc)) {
+        err << "There was a problem reading the input file!" << std::endl;
+        return false;
+    }
+
+    // Check that we have an NE or a PE binary
+    pe_header pe;
+    if((buf[0] == 'N')&&(buf[1] == 'E')) {
+        format = image_format::ne;
+        field_location = new_header_location+NE_CRC_OFFSET;
+        stored_value = load_le32(buf+NE_CRC_OFFSET);
+    } else if(pe_parse_header(buf, num_bytes, pe)) {
+        format = image_format::pe;
+        field_location = new_header_location+PE_CHECKSUM_OFFSET;
+        stored_value = pe.checksum;
+    } else if((buf[0] == 'L')&&((buf[1] == 'E')||(buf[1] == 'X'))) {
+        format = image_format::le;
+        field_location = 0;
+        stored_value = 0;
+    } else {
+        err << "This is not an NE, PE, LE or LX binary!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Open an NE binary and find its CRC field. Returns false after reporting any problem.
+bool open_ne_file(const std::string& input_filepath, input_mode mode, unsigned queue_depth, input_source& source, uint32_t& crc_location, uint32_t& stored_crc, std::ostream& err) {
+    image_format format;
+    if(!open_image(input_filepath, mode, queue_depth, source, format, crc_location, stored_crc, err)) {
+        return false;
+    }
+    if(format != image_format::ne) {
+        err << "This is not an NE binary!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The checksum field checksummed as zeros, plus the user's ranges. A null
+// field_label means the image has no checksum field.
+bool build_mask(uint32_t crc_location, const std::vector<std::string>& zero_ranges, const std::vector<std::string>& exclude_ranges, mask_list& mask, std::ostream& err,
+                const char* field_label = "NE CRC") {
+    if(field_label != nullptr) {
+        mask.add(crc_location, 4, mask_mode::zero, field_label);
+    }
+    for(const std::string& text : zero_ranges) {
+        uint64_t offset, length;
+        if(!parse_mask_range(text, offset, length)) {
+            err << "Invalid range " << text << ", expected offset:length!" << std::endl;
+            return false;
+        }
+        mask.add(offset, length, mask_mode::zero, "zero "+text);
+    }
+    for(const std::string& text : exclude_ranges) {
+        uint64_t offset, length;
+        if(!parse_mask_range(text, offset, length)) {
+            err << "Invalid range " << text << ", expected offset:length!" << std::endl;
+            return false;
+        }
+        mask.add(offset, length, mask_mode::exclude, "exclude "+text);
+    }
+    return true;
+}
+
+// Solve for the init and xorout of each generator, in both bit orders, from
+// the stored CRCs of several files. The data of every file is read once.
+int solve_models(const std::vector<std::string>& input_filepaths, const std::vector<uint32_t>& generators,
+                 const std::vector<std::string>& zero_ranges, const std::vector<std::string>& exclude_ranges, crc_kernel kernel, input_mode mode, unsigned queue_depth) {
+    if(input_filepaths.size() < 2) {
+        std::cerr << "Solving needs at least two input files!" << std::endl;
+        return 1;
+    }
+    if(input_filepaths.size() == 2) {
+        // 64 equations in 64 unknowns, almost any generator fits.
+        std::cerr << "Two samples fit nearly every generator, add a third to tell them apart" << std::endl;
+    }
+    // Registers from zero, for refin and for MSB first input.
+    std::vector<crc_model> models;
+    for(uint32_t generator : generators) {
+        models.push_back({ "", 32, crc32_reflect32(generator), 0, true, true, 0, 0 });
+        models.push_back({ "", 32, crc32_reflect32(generator), 0, false, false, 0, 0 });
+    }
+    std::vector<std::vector<crc_sample>> samples(models.size());
+    for(const std::string& input_filepath : input_filepaths) {
+        uint32_t crc_location, stored_crc;
+        input_source source;
+        if(!open_ne_file(input_filepath, mode, queue_depth, source, crc_location, stored_crc, std::cerr)) {
+            return 1;
+        }
+        mask_list mask;
+        crc_engine_set engines(models, kernel);
+        if(!build_mask(crc_location, zero_ranges, exclude_ranges, mask, std::cerr)||!rc_crc32(source, mask, engines, false, std::cerr)) {
+            return 1;
+        }
+        std::vector<uint64_t> regs = engines.finalize();
+        for(size_t m = 0; m < models.size(); ++m) {
+            // MSB first registers are the reflection of the reflected order ones.
+            uint32_t reg = models[m].refin ? (uint32_t)regs[m] : crc32_reflect32((uint32_t)regs[m]);
+            samples[m].push_back({ engines.engine(m).length(), stored_crc, reg });
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for(size_t m = 0; m < models.size(); ++m) {
+        for(int refout = 1; refout >= 0; --refout) {
+            crc_solution solution;
+            if(!crc_solve_affine(crc32_reflect32((uint32_t)models[m].poly), refout != 0, samples[m], solution)) {
+                continue;
+            }
+            crc_model model = { "", 32, models[m].poly, solution.init, models[m].refin, refout != 0, solution.xorout, 0 };
+            crc_model_lookup(model);
+            std::cout << "Solved: " << crc_model_describe(model);
+            if(!model.name.empty()) {
+                std::cout << " (" << model.name << ")";
+            }
+            if(solution.free_bits != 0) {
+                std::cout << " with " << std::dec << solution.free_bits << " bits undetermined";
+            }
+            std::cout << std::endl;
+            ++found;
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::cerr << "Solved " << std::dec << 2*models.size() << " systems in " << std::chrono::duration<double, std::micro>(stop-start).count() << " us" << std::endl;
+    if(found == 0) {
+        std::cout << "No consistent models" << std::endl;
+    }
+    return 0;
+}
+
+// What to compute for every input.
+struct checksum_job {
+    // The sweep generators, whose models lead the list.
+    std::vector<uint32_t> generators;
+    std::vector<crc_model> models;
+    crc_kernel kernel;
+    std::vector<std::string> zero_ranges;
+    std::vector<std::string> exclude_ranges;
+    bool debug;
+    input_mode mode;
+    unsigned queue_depth;
+    // Report the read bandwidth of each file.
+    bool io_stats;
+    // Index into models of the CRC written back to the NE header, -1 for none.
+    int patch_model;
+    bool patch_fsync;
+    bool patch_atomic;
+    // Check the MZ header's e_csum over the DOS image, and store the right
+    // value when it's off.
+    bool mz_checksum;
+    bool fix_mz_checksum;
+};
+
+// A model's catalogue name, or its parameters when it isn't catalogued.
+static std::string model_label(crc_model model) {
+    return (!model.name.empty() || crc_model_lookup(model)) ? model.name : crc_model_describe(model);
+}
+
+static void print_mz_checksum(uint16_t checksum, uint16_t stored, std::ostream& out) {
+    out << "MZ checksum: " << std::hex << checksum;
+    if(checksum == stored) {
+        out << " (matches)" << std::endl;
+    } else {
+        out << " (stored " << stored << ")" << std::endl;
+    }
+}
+
+// The header of the reports that give a CRC per model on each line.
+static void print_columns(const checksum_job& job) {
+    std::cout << "Columns:";
+    for(size_t m = 0; m < job.models.size(); ++m) {
+        if(m < job.generators.size()) {
+            std::cout << " " << std::hex << job.generators[m];
+        } else {
+            std::cout << " " << model_label(job.models[m]);
+        }
+    }
+    std::cout << std::endl;
+}
+
+// The chunk size given, or for 0 an even split of the file between the
+// pool's threads, but no smaller than a megabyte.
+static uint64_t threaded_chunk_size(uint64_t chunk_size, uint64_t file_size, const thread_pool* pool) {
+    if(chunk_size != 0) {
+        return chunk_size;
+    }
+    size_t threads = (pool != nullptr) ? pool->size() : 1;
+    return std::max<uint64_t>((file_size+threads-1)/threads, 1024*1024);
+}
+
+static void print_crcs(const checksum_job& job, const crc_engine_set& engines, std::ostream& out) {
+    std::vector<uint64_t> new_crcs = engines.finalize();
+    for(size_t g = 0; g < engines.size(); ++g) {
+        if(g < job.generators.size()) {
+            out << "Generator: " << std::hex << job.generators[g] << " -> " << new_crcs[g] << std::endl;
+        } else {
+            const crc_model& model = engines.engine(g).model();
+            out << "Model: " << (model.name.empty() ? crc_model_describe(model) : model.name) << " -> " << std::hex << new_crcs[g] << std::endl;
+        }
+    }
+}
+
+// Collects what a mask_list feeds it.
+struct byte_collector {
+    std::vector<uint8_t> bytes;
+
+    void update(const uint8_t* data, size_t len) {
+        bytes.insert(bytes.end(), data, data+len);
+    }
+    void update_zeros(uint64_t len) {
+        bytes.insert(bytes.end(), len, 0);
+    }
+};
+
+// Checksummed bytes before file offset 'offset', i.e. the offset less any
+// excluded bytes ahead of it.
+static uint64_t masked_offset(const mask_list& mask, uint64_t offset) {
+    uint64_t excluded = 0;
+    for(const mask_range& range : mask.ranges()) {
+        if(range.offset >= offset) {
+            break;
+        }
+        if(range.mode == mask_mode::exclude) {
+            excluded += std::min(range.end(), offset)-range.offset;
+        }
+    }
+    return offset-excluded;
+}
+
+// Bytes to store at an offset of the input when patching it.
+struct file_write {
+    uint64_t offset;
+    std::vector<uint8_t> bytes;
+};
+
+// The 4 little endian bytes of value at offset.
+static file_write dword_write(uint64_t offset, uint32_t value) {
+    return { offset, { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) } };
+}
+
+// Store each write with a single pwrite.
+static bool write_bytes(int fd, const std::vector<file_write>& writes) {
+    for(const file_write& w : writes) {
+        ssize_t n;
+        do {
+            n = pwrite(fd, w.bytes.data(), w.bytes.size(), w.offset);
+        } while((n < 0)&&(errno == EINTR));
+        if(n != (ssize_t)w.bytes.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write a copy of the source with the writes applied next to the original,
+// then rename it over the original. The copy is made by the kernel, the file
+// isn't read again here. The copy is always synced before the rename,
+// sync_dir also syncs the directory after it.
+static bool patch_atomic(const std::string& input_filepath, const input_source& source, const std::vector<file_write>& writes, bool sync_dir, std::ostream& err) {
+    std::string temp_path = input_filepath+".msexecrc.XXXXXX";
+    int fd = mkstemp(&temp_path[0]);
+    if(fd < 0) {
+        err << "Couldn't create a temporary file next to the input!" << std::endl;
+        return false;
+    }
+    struct stat info;
+    bool ok = (fstat(source.descriptor(), &info) == 0)&&(fchmod(fd, info.st_mode & 07777) == 0);
+
+    loff_t in_offset = 0;
+    while(ok && ((uint64_t)in_offset < source.size())) {
+        ssize_t n = copy_file_range(source.descriptor(), &in_offset, fd, nullptr, source.size()-in_offset, 0);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            // Not supported across these file systems, copy through user space.
+            ok = (in_offset == 0)&&source.for_each_block(0, source.size(), INPUT_READ_SIZE, [&](const uint8_t* data, size_t len, uint64_t) {
+                for(size_t done = 0; ok && (done < len);) {
+                    ssize_t w = write(fd, data+done, len-done);
+                    if((w < 0)&&(errno == EINTR)) {
+                        continue;
+                    }
+                    ok = (w > 0);
+                    done += (w > 0) ? w : 0;
+                }
+            })&&ok;
+            break;
+        }
+        if(n == 0) {
+            ok = false;
+        }
+    }
+    ok = ok && write_bytes(fd, writes)&&(fsync(fd) == 0);
+    ok = (close(fd) == 0)&&ok;
+    if(ok && (rename(temp_path.c_str(), input_filepath.c_str()) != 0)) {
+        ok = false;
+    }
+    if(!ok) {
+        err << "There was a problem writing the patched file!" << std::endl;
+        unlink(temp_path.c_str());
+        return false;
+    }
+    if(sync_dir) {
+        // Make the rename itself durable.
+        size_t slash = input_filepath.rfind('/');
+        std::string dir = (slash == std::string::npos) ? "." : input_filepath.substr(0, slash+1);
+        int dir_fd = open(dir.c_str(), O_RDONLY|O_DIRECTORY);
+        if((dir_fd < 0)||(fsync(dir_fd) != 0)) {
+            err << "Couldn't sync the directory of the patched file!" << std::endl;
+            ok = false;
+        }
+        if(dir_fd >= 0) {
+            close(dir_fd);
+        }
+    }
+    return ok;
+}
+
+// Apply the writes in place, or through a renamed copy with --atomic.
+// what names the bytes for the error message.
+static bool write_file(const std::string& input_filepath, const checksum_job& job, const input_source& source,
+                       const std::vector<file_write>& writes, const char* what, std::ostream& err) {
+    if(job.patch_atomic) {
+        return patch_atomic(input_filepath, source, writes, job.patch_fsync, err);
+    }
+    int fd = open(input_filepath.c_str(), O_WRONLY);
+    if(fd < 0) {
+        err << "Couldn't open the input file for writing!" << std::endl;
+        return false;
+    }
+    bool ok = write_bytes(fd, writes)&&(!job.patch_fsync||(fsync(fd) == 0));
+    ok = (close(fd) == 0)&&ok;
+    if(!ok) {
+        err << "There was a problem writing the " << what << "!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Store the chosen model's CRC in the NE header, unless it's already there.
+// Any other writes given are made along with it, in the same open or copy.
+static bool patch_file(const std::string& input_filepath, const checksum_job& job, const input_source& source, uint32_t crc_location,
+                       uint32_t stored_crc, uint32_t crc, std::vector<file_write> writes, std::ostream& out, std::ostream& err) {
+    std::string name = model_label(job.models[job.patch_model]);
+    if(crc != stored_crc) {
+        writes.push_back(dword_write(crc_location, crc));
+    }
+    if(!writes.empty() && !write_file(input_filepath, job, source, writes, "NE CRC", err)) {
+        return false;
+    }
+    if(crc == stored_crc) {
+        out << "Unchanged: " << name << " " << std::hex << crc << std::endl;
+    } else {
+        out << "Patched: " << name << " " << std::hex << stored_crc << " -> " << crc << std::endl;
+    }
+    return true;
+}
+
+// Forward only checksum of an NE image arriving in pieces. e_lfanew in the
+// first 0x40 bytes fixes the CRC field, so only those are held back, every
+// later byte goes straight to the engines. The NE signature is checked as
+// it streams past.
+class ne_stream {
+    public:
+        ne_stream(const checksum_job& job, crc_engine_set& engines, std::ostream& err) : job(job), engines(engines), err(err) {
+        }
+
+        // Returns false, after reporting why, once the input can't be an NE image.
+        bool update(const uint8_t* data, size_t len) {
+            if(!ready) {
+                size_t take = std::min(len, (size_t)MZ_HEADER_SIZE-head.size());
+                head.insert(head.end(), data, data+take);
+                data += take;
+                len -= take;
+                if(head.size() < MZ_HEADER_SIZE) {
+                    return true;
+                }
+                if((head[0] != 'M')||(head[1] != 'Z')) {
+                    err << "This is not a valid microsoft binary!" << std::endl;
+                    return false;
+                }
+                new_header_location = load_le32(head.data()+MZ_LFANEW);
+                if(job.mz_checksum) {
+                    mz_parse_header(head.data(), head.size(), mz);
+                    sums.dos_size = mz.image_size;
+                }
+                if(!build_mask(new_header_location+NE_CRC_OFFSET, job.zero_ranges, job.exclude_ranges, mask, err)) {
+                    return false;
+                }
+                ready = true;
+                if(!process(head.data(), head.size())) {
+                    return false;
+                }
+            }
+            return process(data, len);
+        }
+
+        // Returns false, after reporting why, if the stream ended before the NE header.
+        bool finish() {
+            if(!ready) {
+                err << "This is not a valid microsoft binary!" << std::endl;
+                return false;
+            }
+            if(signature_seen < 2) {
+                err << "There was a problem reading the input file!" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        uint64_t length() const {
+            return position;
+        }
+        // Only once finish has returned true.
+        void print_mz_checksum(std::ostream& out) const {
+            ::print_mz_checksum(mz_checksum_finish(sums.dos_sum, mz.checksum), mz.checksum, out);
+        }
+
+    private:
+        bool process(const uint8_t* data, size_t len) {
+            for(size_t i = 0; i < 2; ++i) {
+                uint64_t at = (uint64_t)new_header_location+i;
+                if((at >= position)&&(at < position+len)) {
+                    if(data[at-position] != (uint8_t)"NE"[i]) {
+                        err << "This is not an NE binary!" << std::endl;
+                        return false;
+                    }
+                    ++signature_seen;
+                }
+            }
+            sums.update(data, len, position);
+            for(size_t done = 0; done < len; done += CRC_BLOCK_SIZE) {
+                size_t n = std::min((size_t)CRC_BLOCK_SIZE, len-done);
+                if(job.debug) {
+                    masked.clear();
+                    collect_masked(mask, data+done, n, position+done, masked);
+                    print_masked(masked, err);
+                }
+                mask.feed(engines, data+done, n, position+done);
+            }
+            position += len;
+            return true;
+        }
+
+        const checksum_job& job;
+        crc_engine_set& engines;
+        std::ostream& err;
+        std::vector<uint8_t> head;
+        std::vector<masked_byte> masked;
+        mask_list mask;
+        mz_header mz = {};
+        word_sums sums;
+        bool ready = false;
+        uint32_t new_header_location = 0;
+        int signature_seen = 0;
+        uint64_t position = 0;
+};
+
+// Bytes per read from a pipe.
+#define STREAM_READ_SIZE (1024*1024)
+
+// Checksum a pipe or other unseekable input in one forward pass, "-" is stdin.
+bool checksum_stream(const std::string& input_filepath, const checksum_job& job, std::ostream& out, std::ostream& err) {
+    if((job.patch_model >= 0)||job.fix_mz_checksum) {
+        err << "Can't patch a stream!" << std::endl;
+        return false;
+    }
+    int fd = 0;
+    if(input_filepath != "-") {
+        fd = open(input_filepath.c_str(), O_RDONLY);
+        if(fd < 0) {
+            err << "There was a problem opening the file to be read!" << std::endl;
+            return false;
+        }
+    }
+    crc_engine_set engines(job.models, job.kernel);
+    ne_stream stream(job, engines, err);
+    std::vector<uint8_t> buf(STREAM_READ_SIZE);
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    while(ok) {
+        ssize_t n = read(fd, buf.data(), buf.size());
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            err << "There was a problem reading the input file!" << std::endl;
+            ok = false;
+        } else if(n == 0) {
+            ok = stream.finish();
+            break;
+        } else {
+            ok = stream.update(buf.data(), n);
+        }
+    }
+    if(fd != 0) {
+        close(fd);
+    }
+    if(!ok) {
+        return false;
+    }
+    if(job.io_stats) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        err << "Read " << std::dec << stream.length() << " bytes in " << seconds << " s, " << (seconds > 0 ? stream.length()/seconds/1e6 : 0)
+            << " MB/s (stream)" << std::endl;
+    }
+    print_crcs(job, engines, out);
+    if(job.mz_checksum) {
+        stream.print_mz_checksum(out);
+    }
+    return true;
+}
+
+// Whether the input has to be read front to back in one go.
+static bool is_stream(const std::string& input_filepath) {
+    struct stat info;
+    if(input_filepath == "-") {
+        return true;
+    }
+    return (stat(input_filepath.c_str(), &info) == 0)&&(S_ISFIFO(info.st_mode)||S_ISCHR(info.st_mode)||S_ISSOCK(info.st_mode));
+}
+
+// Checksum one NE file and write its CRCs to out, problems go to err. Pipes
+// and stdin are streamed, see checksum_stream. With
+// a pool, files larger than chunk_size are split across it, a chunk_size of
+// 0 dividing the file evenly.
+bool checksum_file(const std::string& input_filepath, const checksum_job& job, thread_pool* pool, uint64_t chunk_size, std::ostream& out, std::ostream& err) {
+    if(is_stream(input_filepath)) {
+        return checksum_stream(input_filepath, job, out, err);
+    }
+
+    image_format format;
+    uint32_t crc_location, stored_crc;
+    input_source source;
+    if(!open_image(input_filepath, job.mode, job.queue_depth, source, format, crc_location, stored_crc, err)) {
+        return false;
+    }
+    bool pe = (format == image_format::pe);
+    if((format != image_format::ne)&&(job.patch_model >= 0)) {
+        err << (pe ? "A PE image" : "An LE or LX image") << " has no CRC field to patch!" << std::endl;
+        return false;
+    }
+
+    mask_list mask;
+    const char* field_label = pe ? "PE checksum" : (format == image_format::ne) ? "NE CRC" : nullptr;
+    if(!build_mask(crc_location, job.zero_ranges, job.exclude_ranges, mask, err, field_label)) {
+        return false;
+    }
+    crc_engine_set engines(job.models, job.kernel);
+
+    uint64_t file_size = source.size();
+    size_t threads = (pool != nullptr) ? pool->size() : 1;
+    chunk_size = threaded_chunk_size(chunk_size, file_size, pool);
+
+    // The PE image checksum and e_csum are summed over the same pass as the CRCs.
+    word_sums sums;
+    sums.image = pe;
+    mz_header mz = {};
+    if(job.mz_checksum) {
+        std::vector<uint8_t> scratch;
+        const uint8_t* data;
+        size_t got;
+        if(!source.view(0, MZ_HEADER_SIZE, scratch, data, got)||!mz_parse_header(data, got, mz)) {
+            err << "There was a problem reading the input file!" << std::endl;
+            return false;
+        }
+        sums.dos_size = std::min(mz.image_size, file_size);
+    }
+    auto start = std::chrono::steady_clock::now();
+    if((threads > 1)&&(file_size > chunk_size)) {
+        if(!rc_crc32_chunked(source, mask, engines, *pool, chunk_size, job.debug, err, &sums)) {
+            return false;
+        }
+    } else if(!rc_crc32(source, mask, engines, job.debug, err, &sums)) {
+        return false;
+    }
+    if(job.io_stats) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        err << "Read " << std::dec << file_size << " bytes in " << seconds << " s, " << (seconds > 0 ? file_size/seconds/1e6 : 0)
+            << " MB/s (" << source.reader_name() << ")" << std::endl;
+    }
+
+    print_crcs(job, engines, out);
+    if(pe) {
+        uint32_t checksum = image_checksum_finish(sums.image_sum, file_size, stored_crc);
+        out << "Image checksum: " << std::hex << checksum;
+        if(checksum == stored_crc) {
+            out << " (matches)" << std::endl;
+        } else {
+            out << " (stored " << stored_crc << ")" << std::endl;
+        }
+    }
+    std::vector<file_write> writes;
+    uint16_t mz_checksum = mz_checksum_finish(sums.dos_sum, mz.checksum);
+    if(job.mz_checksum) {
+        print_mz_checksum(mz_checksum, mz.checksum, out);
+    }
+    if(job.fix_mz_checksum && (mz_checksum != mz.checksum)) {
+        writes.push_back({ MZ_CSUM, { (uint8_t)mz_checksum, (uint8_t)(mz_checksum >> 8) } });
+    }
+    if(job.patch_model >= 0) {
+        uint32_t crc = (uint32_t)engines.finalize()[job.patch_model];
+        if(!writes.empty()) {
+            // The new e_csum is part of what the patched CRC covers.
+            if(crc_location < sums.dos_size) {
+                err << "The NE CRC lies inside the DOS image, it and e_csum can't both be fixed!" << std::endl;
+                return false;
+            }
+            uint8_t old_bytes[2] = { (uint8_t)mz.checksum, (uint8_t)(mz.checksum >> 8) };
+            byte_collector old_side, new_side;
+            mask.feed(old_side, old_bytes, 2, MZ_CSUM);
+            mask.feed(new_side, writes[0].bytes.data(), 2, MZ_CSUM);
+            crc_edit edit;
+            edit.offset = masked_offset(mask, MZ_CSUM);
+            edit.old_bytes = std::move(old_side.bytes);
+            edit.new_bytes = std::move(new_side.bytes);
+            crc = (uint32_t)engines.engine(job.patch_model).apply_edits(crc, masked_offset(mask, file_size), std::vector<crc_edit>(1, edit));
+        }
+        if(!patch_file(input_filepath, job, source, crc_location, stored_crc, crc, writes, out, err)) {
+            return false;
+        }
+    } else if(!writes.empty() && !write_file(input_filepath, job, source, writes, "MZ checksum", err)) {
+        return false;
+    }
+    if(!writes.empty()) {
+        out << "Fixed MZ checksum: " << std::hex << mz.checksum << " -> " << mz_checksum << std::endl;
+    }
+    return true;
+}
+
+// Parse an edit "offset:oldhex", the offset in decimal or 0x prefixed hex and
+// the bytes the file held there before it was changed.
+static bool parse_edit(const std::string& text, uint64_t& offset, std::vector<uint8_t>& old_bytes) {
+    size_t colon = text.find(':');
+    if(colon == std::string::npos) {
+        return false;
+    }
+    std::string offset_text = text.substr(0, colon);
+    std::string bytes_text = text.substr(colon+1);
+    char* end = nullptr;
+    offset = strtoull(offset_text.c_str(), &end, 0);
+    if(offset_text.empty()||(*end != '\0')||bytes_text.empty()||(bytes_text.size()%2 != 0)) {
+        return false;
+    }
+    old_bytes.clear();
+    for(size_t i = 0; i < bytes_text.size(); i += 2) {
+        std::string pair = bytes_text.substr(i, 2);
+        if(!isxdigit((unsigned char)pair[0])||!isxdigit((unsigned char)pair[1])) {
+            return false;
+        }
+        old_bytes.push_back((uint8_t)strtoul(pair.c_str(), nullptr, 16));
+    }
+    return true;
+}
+
+// Work out the CRC of an edited file from its CRC before the edits, reading
+// only the edited ranges. The old CRC defaults to the one stored in the NE
+// header, and the new one is written back when patching.
+int update_crc(const std::string& input_filepath, const checksum_job& job, size_t model_index, const std::vector<std::string>& edit_texts,
+               const std::string& old_crc_text) {
+    const crc_model& model = job.models[model_index];
+    uint32_t crc_location, stored_crc;
+    input_source source;
+    if(!open_ne_file(input_filepath, job.mode, job.queue_depth, source, crc_location, stored_crc, std::cerr)) {
+        return 1;
+    }
+    mask_list mask;
+    if(!build_mask(crc_location, job.zero_ranges, job.exclude_ranges, mask, std::cerr)) {
+        return 1;
+    }
+    uint64_t old_crc = stored_crc;
+    if(!old_crc_text.empty()) {
+        char* end = nullptr;
+        old_crc = strtoull(old_crc_text.c_str(), &end, 16);
+        if((end == old_crc_text.c_str())||(*end != '\0')) {
+            std::cerr << "Invalid CRC " << old_crc_text << "!" << std::endl;
+            return 1;
+        }
+    }
+    uint64_t file_size = source.size();
+
+    // Move each edit into checksummed offsets, masking both sides the way a
+    // full pass would see them. The old bytes are all taken from the file
+    // before any edit and the new ones from the file after every edit, so
+    // edits can't overlap.
+    std::vector<crc_edit> edits;
+    std::vector<std::pair<uint64_t, uint64_t>> spans;
+    std::vector<uint8_t> scratch;
+    for(const std::string& text : edit_texts) {
+        crc_edit edit;
+        std::vector<uint8_t> old_bytes;
+        uint64_t offset;
+        if(!parse_edit(text, offset, old_bytes)) {
+            std::cerr << "Invalid edit " << text << ", expected offset:oldhex!" << std::endl;
+            return 1;
+        }
+        if((offset > file_size)||(old_bytes.size() > file_size-offset)) {
+            std::cerr << "The edit " << text << " runs past the end of the file!" << std::endl;
+            return 1;
+        }
+        for(const std::pair<uint64_t, uint64_t>& span : spans) {
+            if((offset < span.second)&&(span.first < offset+old_bytes.size())) {
+                std::cerr << "The edit " << text << " overlaps an earlier edit!" << std::endl;
+                return 1;
+            }
+        }
+        spans.emplace_back(offset, offset+old_bytes.size());
+        const uint8_t* data;
+        size_t got;
+        if(!source.view(offset, old_bytes.size(), scratch, data, got)||(got != old_bytes.size())) {
+            std::cerr << "There was a problem reading the input file!" << std::endl;
+            return 1;
+        }
+        byte_collector old_side, new_side;
+        mask.feed(old_side, old_bytes.data(), old_bytes.size(), offset);
+        mask.feed(new_side, data, got, offset);
+        edit.offset = masked_offset(mask, offset);
+        edit.old_bytes = std::move(old_side.bytes);
+        edit.new_bytes = std::move(new_side.bytes);
+        edits.push_back(std::move(edit));
+    }
+
+    crc_engine engine(model, job.kernel);
+    uint64_t crc = engine.apply_edits(old_crc, masked_offset(mask, file_size), edits);
+    std::cout << "Updated: " << model_label(model) << " " << std::hex << old_crc << " -> " << crc << std::endl;
+    if(job.patch_model >= 0) {
+        return patch_file(input_filepath, job, source, crc_location, stored_crc, (uint32_t)crc, {}, std::cout, std::cerr) ? 0 : 1;
+    }
+    return 0;
+}
+
+// Patch the 4 bytes at force_location so the file's CRC becomes target, by
+// default the stored NE CRC. One pass finds the current CRC, the patch is
+// then solved for directly and checked by moving the CRC forward over it.
+int force_crc(const std::string& input_filepath, const checksum_job& job, size_t model_index, uint64_t force_location,
+              const std::string& target_text, thread_pool* pool, uint64_t chunk_size) {
+    const crc_model& model = job.models[model_index];
+    crc_engine engine(model, job.kernel);
+    uint32_t crc_location, stored_crc;
+    input_source source;
+    if(!open_ne_file(input_filepath, job.mode, job.queue_depth, source, crc_location, stored_crc, std::cerr)) {
+        return 1;
+    }
+    mask_list mask;
+    if(!build_mask(crc_location, job.zero_ranges, job.exclude_ranges, mask, std::cerr)) {
+        return 1;
+    }
+    uint64_t target = stored_crc;
+    if(!target_text.empty()) {
+        uint32_t value;
+        if(!parse_hex32(target_text, value)) {
+            std::cerr << "Invalid CRC " << target_text << "!" << std::endl;
+            return 1;
+        }
+        target = value;
+    }
+    uint64_t file_size = source.size();
+    if((force_location > file_size)||(file_size-force_location < 4)) {
+        std::cerr << "The forced bytes run past the end of the file!" << std::endl;
+        return 1;
+    }
+    size_t r = mask.first_after(force_location);
+    if((r < mask.ranges().size())&&(mask.ranges()[r].offset < force_location+4)) {
+        std::cerr << "The forced bytes overlap the masked range " << mask.ranges()[r].label << "!" << std::endl;
+        return 1;
+    }
+
+    crc_engine_set engines(std::vector<crc_model>(1, model), job.kernel);
+    size_t threads = (pool != nullptr) ? pool->size() : 1;
+    chunk_size = threaded_chunk_size(chunk_size, file_size, pool);
+    if((threads > 1)&&(file_size > chunk_size)) {
+        if(!rc_crc32_chunked(source, mask, engines, *pool, chunk_size, false, std::cerr)) {
+            return 1;
+        }
+    } else if(!rc_crc32(source, mask, engines, false, std::cerr)) {
+        return 1;
+    }
+    uint64_t crc = engines.finalize()[0];
+    if(crc == target) {
+        std::cout << "Unchanged: " << model_label(model) << " " << std::hex << crc << std::endl;
+        return 0;
+    }
+
+    std::vector<uint8_t> scratch;
+    const uint8_t* data;
+    size_t got;
+    if(!source.view(force_location, 4, scratch, data, got)||(got != 4)) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return 1;
+    }
+    crc_edit edit;
+    edit.offset = masked_offset(mask, force_location);
+    edit.old_bytes.assign(data, data+4);
+    edit.new_bytes.resize(4);
+    if(!engine.force(crc, masked_offset(mask, file_size), edit.offset, edit.old_bytes.data(), target, edit.new_bytes.data())) {
+        std::cerr << "Can't force " << model_label(model) << ", only dword sums and reflected 32 bit CRCs with an x^0 term can be forced!" << std::endl;
+        return 1;
+    }
+    if(engine.apply_edits(crc, masked_offset(mask, file_size), std::vector<crc_edit>(1, edit)) != target) {
+        std::cerr << "The forced bytes don't give the target CRC!" << std::endl;
+        return 1;
+    }
+    if(!write_file(input_filepath, job, source, std::vector<file_write>(1, { force_location, edit.new_bytes }), "forced bytes", std::cerr)) {
+        return 1;
+    }
+
+    // Read the bytes back from the file as it now is.
+    source.close();
+    std::string error;
+    if(!source.open(input_filepath, input_mode::pread, error)||!source.view(force_location, 4, scratch, data, got)||(got != 4)||
+       !std::equal(data, data+4, edit.new_bytes.begin())) {
+        std::cerr << "The forced bytes didn't reach the file!" << std::endl;
+        return 1;
+    }
+    std::cout << "Forced: " << model_label(model) << " " << std::hex << crc << " -> " << target << " with";
+    for(uint8_t byte : edit.new_bytes) {
+        std::cout << " " << std::setw(2) << std::setfill('0') << (unsigned)byte;
+    }
+    std::cout << " at 0x" << force_location << std::endl;
+    return 0;
+}
+
+// A resource type or id, as a number or a name.
+static std::string resource_label(uint16_t id, std::string_view name) {
+    if(id & 0x8000) {
+        return std::to_string(id & 0x7fff);
+    }
+    return std::string(name);
+}
+
+// Whether e_lfanew points at an LE or LX header.
+static bool has_le_signature(const uint8_t* data, size_t size) {
+    if((size < MZ_HEADER_SIZE)||(data[0] != 'M')||(data[1] != 'Z')) {
+        return false;
+    }
+    uint64_t at = load_le32(data+MZ_LFANEW);
+    return (at+2 <= size)&&(data[at] == 'L')&&((data[at+1] == 'E')||(data[at+1] == 'X'));
+}
+
+// Print the LE or LX header, objects and pages.
+static int print_le_info(const uint8_t* data, size_t size) {
+    le_image image;
+    std::string error;
+    if(!image.parse(data, size, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << std::hex << "Header: 0x" << image.header_offset() << (image.lx() ? " LX" : " LE") << " cpu " << image.cpu_type() << " os " << image.os_type()
+              << " version " << image.module_version() << " flags " << image.module_flags() << std::dec << " pages " << image.page_count()
+              << std::hex << " page size 0x" << image.page_size() << std::endl;
+    std::cout << std::hex << "Loader section: offset 0x" << image.loader_section_offset() << " length 0x" << image.loader_section_size()
+              << " checksum " << image.loader_section_checksum() << std::endl;
+    std::cout << std::hex << "Fixup section: offset 0x" << image.fixup_section_offset() << " length 0x" << image.fixup_section_size()
+              << " checksum " << image.fixup_section_checksum() << std::endl;
+    bool ok = true;
+    if(!image.for_each_object([&](const le_object& object) {
+        std::cout << std::dec << "Object " << object.index << std::hex << ": base 0x" << object.base_address << " size 0x" << object.virtual_size
+                  << " flags " << object.flags << std::dec << " pages " << object.page_count << std::endl;
+        if(!image.for_each_page(object, [&](const le_page& page) {
+            std::cout << std::dec << "Page " << page.index << std::hex << ": offset 0x" << page.file_offset << " length 0x" << page.file_length
+                      << " flags " << page.flags;
+            uint32_t checksum;
+            if(image.page_checksum(page.index, checksum)) {
+                std::cout << " checksum " << checksum;
             }
+            std::cout << std::endl;
+        })) {
+            std::cerr << "Malformed object page table!" << std::endl;
+            ok = false;
         }
-        table[i] = rem;
+    })) {
+        std::cerr << "Malformed object table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_resident_name([&](const ne_name& name) {
+        std::cout << std::dec << "Resident name " << name.ordinal << ": " << name.text << std::endl;
+    })) {
+        std::cerr << "Malformed resident name table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_nonresident_name([&](const ne_name& name) {
+        std::cout << std::dec << "Non-resident name " << name.ordinal << ": " << name.text << std::endl;
+    })) {
+        std::cerr << "Malformed non-resident name table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_module([&](std::string_view name) {
+        std::cout << "Module: " << name << std::endl;
+    })) {
+        std::cerr << "Malformed import module table!" << std::endl;
+        ok = false;
     }
+    return ok ? 0 : 1;
+}
 
-    // Seek to beginning of file.
-    if(fseek(the_file, 0, SEEK_SET) != 0) {
-        std::cerr << "There was a problem seeking to the beginning!" << std::endl;
-        return 0;
+// --ne-info and the segment report walk tables spread through the image,
+// so they hold it in memory whole, read into a buffer when it can't be
+// mapped. Real NE and LE images are far smaller than this, but a large
+// alignment shift lets an NE header point gigabytes out.
+#define IMAGE_VIEW_MAX (64*1024*1024)
+
+// Print the NE header and tables, or the LE or LX ones. The whole file is
+// mapped, or read when it can't be.
+int print_ne_info(const std::string& input_filepath, input_mode mode, unsigned queue_depth) {
+    input_source source;
+    std::string error;
+    if(!source.open(input_filepath, mode, error, queue_depth)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if(source.size() > IMAGE_VIEW_MAX) {
+        std::cerr << "--ne-info takes images up to " << std::dec << IMAGE_VIEW_MAX/(1024*1024) << " MB!" << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> scratch;
+    const uint8_t* data;
+    size_t size;
+    if(!source.view(0, source.size(), scratch, data, size)||(size != source.size())) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return 1;
+    }
+    if(has_le_signature(data, size)) {
+        return print_le_info(data, size);
+    }
+    ne_image image;
+    if(!image.parse(data, size, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::cout << std::hex << "Header: 0x" << image.header_offset() << " linker " << std::dec << (unsigned)image.linker_version() << "."
+              << (unsigned)image.linker_revision() << std::hex << " flags " << image.flags() << " os " << (unsigned)image.target_os()
+              << std::dec << " windows " << (image.expected_windows_version() >> 8) << "." << (image.expected_windows_version() & 0xff)
+              << std::hex << " crc " << image.stored_crc() << std::endl;
+    bool ok = true;
+    if(!image.for_each_segment([&](const ne_segment& segment) {
+        std::cout << std::dec << "Segment " << segment.index << std::hex << ": offset 0x" << segment.file_offset << " length 0x"
+                  << segment.file_length << " flags " << segment.flags << " alloc 0x" << segment.min_alloc
+                  << ((segment.flags & NE_SEGMENT_DATA) ? " data" : " code") << std::dec << " relocations " << segment.relocation_count << std::endl;
+        image.for_each_relocation(segment, [&](const ne_relocation& relocation) {
+            std::cout << std::hex << "Relocation: type " << (unsigned)relocation.source_type << " flags " << (unsigned)relocation.flags << " offset 0x"
+                      << relocation.offset << " target " << relocation.target1 << ":" << relocation.target2 << std::endl;
+        });
+    })) {
+        std::cerr << "Malformed segment table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_resource([&](const ne_resource& resource) {
+        std::cout << "Resource " << resource_label(resource.type_id, resource.type_name) << "/" << resource_label(resource.id, resource.name)
+                  << std::hex << ": offset 0x" << resource.file_offset << " length 0x" << resource.file_length << " flags " << resource.flags << std::endl;
+    })) {
+        std::cerr << "Malformed resource table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_resident_name([&](const ne_name& name) {
+        std::cout << std::dec << "Resident name " << name.ordinal << ": " << name.text << std::endl;
+    })) {
+        std::cerr << "Malformed resident name table!" << std::endl;
+        ok = false;
     }
+    if(!image.for_each_nonresident_name([&](const ne_name& name) {
+        std::cout << std::dec << "Non-resident name " << name.ordinal << ": " << name.text << std::endl;
+    })) {
+        std::cerr << "Malformed non-resident name table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_module([&](std::string_view name) {
+        std::cout << "Module: " << name << std::endl;
+    })) {
+        std::cerr << "Malformed module reference table!" << std::endl;
+        ok = false;
+    }
+    if(!image.for_each_entry([&](const ne_entry& entry) {
+        std::cout << std::dec << "Entry " << entry.ordinal << ": " << (unsigned)entry.segment << ":" << std::hex << std::setw(4) << std::setfill('0')
+                  << entry.offset << std::setfill(' ') << " flags " << (unsigned)entry.flags << (entry.movable ? " movable" : " fixed") << std::endl;
+    })) {
+        std::cerr << "Malformed entry table!" << std::endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
 
-    size_t num_bytes = 0;
-    size_t buff_base = 0;
-    uint32_t crc = 0;
-    crc = ~crc;
-    while(true) {
-        // Read the next BUFFER_SIZE worth of bytes
-        num_bytes = fread(buf, 1, BUFFER_SIZE, the_file);
+// A run of the file between two segment or resource boundaries.
+struct report_piece {
+    uint64_t offset;
+    uint64_t length;
+    crc_engine_set engines;
+};
 
-        for(size_t i = 0; i < num_bytes; ++i) {
-            if (((i+buff_base) >= (word_loc+4))||((i+buff_base) < word_loc)) {
-                octet = *((uint8_t*)(buf+i));
-            } else {
-                std::cout << "Overriding byte " << std::hex << (i+buff_base) << " = " << (uint16_t)(*((uint8_t*)(buf+i))) << std::endl;
-                octet = 0;
+// A segment, resource, page or section and the CRCs of its bytes.
+struct report_range {
+    std::string label;
+    uint64_t offset;
+    uint64_t length;
+    std::vector<uint64_t> crcs;
+    // Printed after the CRCs, such as a stored checksum.
+    std::string note;
+};
+
+// The segments of an NE image, and with resources its resources.
+static bool ne_report_ranges(const uint8_t* data, size_t file_size, bool resources, std::vector<report_range>& ranges) {
+    ne_image image;
+    std::string error;
+    if(!image.parse(data, file_size, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    bool ok = image.for_each_segment([&](const ne_segment& segment) {
+        if(segment.file_offset == 0) {
+            return;
+        }
+        uint64_t end = (segment.flags & NE_SEGMENT_RELOCINFO) ? segment.relocation_offset+segment.relocation_count*8 : segment.file_offset+segment.file_length;
+        ranges.push_back({ "Segment "+std::to_string(segment.index), segment.file_offset, end-segment.file_offset, {}, "" });
+    });
+    if(!ok) {
+        std::cerr << "Malformed segment table!" << std::endl;
+        return false;
+    }
+    if(resources&&!image.for_each_resource([&](const ne_resource& resource) {
+        // Resource lengths are rounded up to the alignment, so may overrun the file.
+        uint64_t offset = std::min<uint64_t>(resource.file_offset, file_size);
+        uint64_t length = std::min<uint64_t>(resource.file_length, file_size-offset);
+        ranges.push_back({ "Resource "+resource_label(resource.type_id, resource.type_name)+"/"+resource_label(resource.id, resource.name), offset, length, {}, "" });
+    })) {
+        std::cerr << "Malformed resource table!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The pages of an LE or LX image, then its loader and fixup sections, each
+// with its stored checksum.
+static bool le_report_ranges(const uint8_t* data, size_t file_size, std::vector<report_range>& ranges) {
+    le_image image;
+    std::string error;
+    if(!image.parse(data, file_size, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    bool pages_ok = true;
+    bool ok = image.for_each_object([&](const le_object& object) {
+        pages_ok = image.for_each_page(object, [&](const le_page& page) {
+            if(page.file_offset == 0) {
+                return;
+            }
+            std::ostringstream note;
+            uint32_t checksum;
+            if(image.page_checksum(page.index, checksum)) {
+                note << " (stored " << std::hex << checksum << ")";
             }
-            crc = (crc >> 8) ^ table[(crc & 0xff) ^ octet];
+            ranges.push_back({ "Page "+std::to_string(page.index), page.file_offset, page.file_length, {}, note.str() });
+        })&&pages_ok;
+    });
+    if(!ok||!pages_ok) {
+        std::cerr << "Malformed object table!" << std::endl;
+        return false;
+    }
+    auto add_section = [&](const char* label, uint64_t offset, uint64_t length, uint32_t checksum) {
+        offset = std::min<uint64_t>(offset, file_size);
+        length = std::min<uint64_t>(length, file_size-offset);
+        // A section the image doesn't have has nothing to checksum.
+        if(length == 0) {
+            return;
+        }
+        std::ostringstream note;
+        note << " (stored " << std::hex << checksum << ")";
+        ranges.push_back({ label, offset, length, {}, note.str() });
+    };
+    add_section("Loader section", image.loader_section_offset(), image.loader_section_size(), image.loader_section_checksum());
+    add_section("Fixup section", image.fixup_section_offset(), image.fixup_section_size(), image.fixup_section_checksum());
+    return true;
+}
+
+// CRCs of each NE segment, and with resources of each resource, or of each
+// LE or LX page and section, followed by the file CRCs. Segments take in
+// their relocation records. The file is cut at every range boundary and the
+// pieces are checksummed once each on the pool, so the pages of an LE image
+// are spread across it, then the range and file CRCs are put together with
+// append. The image is held in memory whole, up to IMAGE_VIEW_MAX.
+int segment_report(const std::string& input_filepath, const checksum_job& job, thread_pool* pool, uint64_t chunk_size, bool resources) {
+    image_format format;
+    uint32_t crc_location, stored_crc;
+    input_source source;
+    if(!open_image(input_filepath, job.mode, job.queue_depth, source, format, crc_location, stored_crc, std::cerr)) {
+        return 1;
+    }
+    if(format == image_format::pe) {
+        std::cerr << "The segment report needs an NE, LE or LX binary!" << std::endl;
+        return 1;
+    }
+    if(resources&&(format != image_format::ne)) {
+        std::cerr << "--resources needs an NE binary!" << std::endl;
+        return 1;
+    }
+    mask_list mask;
+    if(!build_mask(crc_location, job.zero_ranges, job.exclude_ranges, mask, std::cerr, (format == image_format::ne) ? "NE CRC" : nullptr)) {
+        return 1;
+    }
+    if(source.size() > IMAGE_VIEW_MAX) {
+        std::cerr << "The segment report takes images up to " << std::dec << IMAGE_VIEW_MAX/(1024*1024) << " MB!" << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> scratch;
+    const uint8_t* data;
+    size_t file_size;
+    if(!source.view(0, source.size(), scratch, data, file_size)||(file_size != source.size())) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return 1;
+    }
+    std::vector<report_range> ranges;
+    if((format == image_format::ne) ? !ne_report_ranges(data, file_size, resources, ranges) : !le_report_ranges(data, file_size, ranges)) {
+        return 1;
+    }
+
+    // Cut at every boundary, and split long pieces so the pool stays busy.
+    chunk_size = threaded_chunk_size(chunk_size, file_size, pool);
+    std::vector<uint64_t> cuts = { 0, file_size };
+    for(const report_range& range : ranges) {
+        cuts.push_back(range.offset);
+        cuts.push_back(range.offset+range.length);
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    crc_engine_set engines(job.models, job.kernel);
+    std::vector<report_piece> pieces;
+    for(size_t c = 0; c+1 < cuts.size(); ++c) {
+        for(uint64_t offset = cuts[c]; offset < cuts[c+1]; offset += chunk_size) {
+            pieces.push_back({ offset, std::min(chunk_size, cuts[c+1]-offset), engines.clone() });
+            pieces.back().engines.reset();
+        }
+    }
+    auto checksum_piece = [data, &mask](report_piece& piece) {
+        for(uint64_t done = 0; done < piece.length; done += CRC_BLOCK_SIZE) {
+            size_t n = (size_t)std::min<uint64_t>(CRC_BLOCK_SIZE, piece.length-done);
+            mask.feed(piece.engines, data+piece.offset+done, n, piece.offset+done);
+        }
+    };
+    for(report_piece& piece : pieces) {
+        if(pool != nullptr) {
+            report_piece* p = &piece;
+            pool->submit([&checksum_piece, p] { checksum_piece(*p); });
+        } else {
+            checksum_piece(piece);
+        }
+    }
+    if(pool != nullptr) {
+        pool->wait();
+    }
+
+    for(report_range& range : ranges) {
+        auto first = std::lower_bound(pieces.begin(), pieces.end(), range.offset, [](const report_piece& piece, uint64_t offset) {
+            return piece.offset < offset;
+        });
+        crc_engine_set sum = engines.clone();
+        for(auto piece = first; (piece != pieces.end())&&(piece->offset < range.offset+range.length); ++piece) {
+            sum.append(piece->engines);
+        }
+        range.crcs = sum.finalize();
+    }
+    for(const report_piece& piece : pieces) {
+        engines.append(piece.engines);
+    }
+
+    print_columns(job);
+    for(const report_range& range : ranges) {
+        std::cout << range.label << std::hex << ": offset 0x" << range.offset << " length 0x" << range.length << " ->";
+        for(uint64_t crc : range.crcs) {
+            std::cout << " " << crc;
         }
+        std::cout << range.note << std::endl;
+    }
+    print_crcs(job, engines, std::cout);
+    return 0;
+}
+
+// Bytes scanned for "MZ" at a time when carving.
+#define CARVE_SCAN_BLOCK (1024*1024)
+// e_lfanew further out than this isn't taken for a header.
+#define CARVE_MAX_LFANEW 0x100000
+// The window read to find an image's extent starts at CARVE_WINDOW_MIN and
+// grows up to CARVE_WINDOW_MAX when its tables reach further.
+#define CARVE_WINDOW_MIN (1024*1024)
+#define CARVE_WINDOW_MAX (64*1024*1024)
+// Hits checksummed on the pool at a time, per thread.
+#define CARVE_BATCH 16
 
-        buff_base += num_bytes;
+// An executable found inside a larger file, and its checksums.
+struct carve_hit {
+    uint64_t offset;
+    uint64_t length;
+    image_format format;
+    char signature[3];
+    // Relative to the image, with field_location 0 for LE and LX.
+    uint32_t field_location;
+    uint32_t stored_value;
+    bool valid;
+    bool truncated;
+    std::vector<uint64_t> crcs;
+    uint32_t image_checksum;
+};
+
+// Whether the "MZ" at offset leads to an NE, PE, LE or LX header, from
+// e_lfanew and the signature alone. Reads a few bytes through views.
+static bool carve_candidate(const input_source& source, uint64_t offset, carve_hit& hit) {
+    std::vector<uint8_t> scratch;
+    const uint8_t* data;
+    size_t got;
+    if(!source.view(offset+MZ_LFANEW, 4, scratch, data, got)||(got != 4)) {
+        return false;
+    }
+    uint32_t new_header_location = load_le32(data);
+    if((new_header_location < MZ_HEADER_SIZE)||(new_header_location > CARVE_MAX_LFANEW)) {
+        return false;
+    }
+    if(!source.view(offset+new_header_location, 4, scratch, data, got)||(got != 4)) {
+        return false;
+    }
+    if((data[0] == 'N')&&(data[1] == 'E')) {
+        hit.format = image_format::ne;
+        hit.field_location = new_header_location+NE_CRC_OFFSET;
+    } else if((data[0] == 'P')&&(data[1] == 'E')&&(data[2] == 0)&&(data[3] == 0)) {
+        hit.format = image_format::pe;
+        hit.field_location = new_header_location+PE_CHECKSUM_OFFSET;
+    } else if((data[0] == 'L')&&((data[1] == 'E')||(data[1] == 'X'))) {
+        hit.format = image_format::le;
+        hit.field_location = 0;
+    } else {
+        return false;
+    }
+    hit.offset = offset;
+    hit.signature[0] = data[0];
+    hit.signature[1] = data[1];
+    hit.signature[2] = 0;
+    hit.valid = false;
+    return true;
+}
 
-        if(feof(the_file) != 0) {
-            // at end of file
+// Find the hit's extent from its headers and checksum it. The window read
+// for the headers grows until every table fits, then the image is fed
+// through the engines in blocks like any other file.
+static void carve_checksum(const input_source& source, const checksum_job& job, const crc_engine_set& prototype, carve_hit& hit) {
+    uint64_t available = source.size()-hit.offset;
+    std::vector<uint8_t> scratch;
+    uint64_t end = 0;
+    bool found = false;
+    for(uint64_t window = CARVE_WINDOW_MIN; !found; window *= 4) {
+        window = std::min<uint64_t>(window, std::min<uint64_t>(available, CARVE_WINDOW_MAX));
+        const uint8_t* data;
+        size_t got;
+        if(!source.view(hit.offset, (size_t)window, scratch, data, got)) {
+            return;
+        }
+        std::string error;
+        bool parsed;
+        if(hit.format == image_format::ne) {
+            ne_image image;
+            parsed = image.parse(data, got, error);
+            found = parsed&&image.image_end(end);
+            hit.stored_value = parsed ? image.stored_crc() : 0;
+        } else if(hit.format == image_format::pe) {
+            pe_header header;
+            uint32_t pe_offset = load_le32(data+MZ_LFANEW);
+            parsed = (pe_offset <= got)&&pe_parse_header(data+pe_offset, got-pe_offset, header);
+            found = parsed&&pe_image_end(data, got, end);
+            hit.stored_value = parsed ? header.checksum : 0;
+        } else {
+            le_image image;
+            parsed = image.parse(data, got, error);
+            found = parsed&&image.image_end(end);
+            hit.stored_value = 0;
+        }
+        if(!found&&(got == std::min<uint64_t>(available, CARVE_WINDOW_MAX))) {
+            if(!parsed||(got != available)) {
+                // Malformed, or an image bigger than we look for.
+                return;
+            }
+            // The tables run off the end of the input, keep what there is.
+            hit.truncated = true;
+            end = available;
             break;
         }
     }
+    hit.truncated = hit.truncated||(end > available);
+    hit.length = std::min(end, available);
+
+    mask_list mask;
+    const char* field_label = (hit.format == image_format::ne) ? "NE CRC" : (hit.format == image_format::pe) ? "PE checksum" : nullptr;
+    std::ostringstream err;
+    if(!build_mask(hit.field_location, job.zero_ranges, job.exclude_ranges, mask, err, field_label)) {
+        return;
+    }
+    crc_engine_set engines = prototype.clone();
+    uint64_t image_sum = 0;
+    bool ok = source.for_each_block(hit.offset, hit.length, CRC_BLOCK_SIZE, [&](const uint8_t* data, size_t n, uint64_t pos) {
+        if(hit.format == image_format::pe) {
+            image_sum = image_sum_update(image_sum, data, n, pos-hit.offset);
+        }
+        mask.feed(engines, data, n, pos-hit.offset);
+    });
+    if(!ok) {
+        return;
+    }
+    hit.crcs = engines.finalize();
+    hit.image_checksum = image_checksum_finish(image_sum, hit.length, hit.stored_value);
+    hit.valid = true;
+}
+
+static void print_carve_hit(const checksum_job& job, const carve_hit& hit) {
+    std::cout << "Image 0x" << std::hex << hit.offset << " " << hit.signature << " length 0x" << hit.length << " ->";
+    for(uint64_t crc : hit.crcs) {
+        std::cout << " " << crc;
+    }
+    if(hit.format == image_format::ne) {
+        std::cout << " (stored " << hit.stored_value;
+        for(size_t m = 0; m < hit.crcs.size(); ++m) {
+            if(hit.crcs[m] == hit.stored_value) {
+                std::cout << ", matches ";
+                if(m < job.generators.size()) {
+                    std::cout << "generator " << job.generators[m];
+                } else {
+                    std::cout << model_label(job.models[m]);
+                }
+                break;
+            }
+        }
+        std::cout << ")";
+    } else if(hit.format == image_format::pe) {
+        std::cout << " checksum " << hit.image_checksum;
+        if(hit.image_checksum == hit.stored_value) {
+            std::cout << " (matches)";
+        } else {
+            std::cout << " (stored " << hit.stored_value << ")";
+        }
+    }
+    std::cout << (hit.truncated ? " truncated" : "") << std::endl;
+}
+
+// Carve every NE, PE, LE and LX image out of a disk or floppy image. One
+// forward scan looks for "MZ" with the SIMD kernel and checks e_lfanew and
+// the signature behind each candidate in place. The hits are then sized
+// from their headers and checksummed in batches on the pool, so memory
+// stays bounded by the scan block and a window per thread however large
+// the input is. Images found inside others are reported too.
+int carve_images(const std::string& input_filepath, const checksum_job& job, thread_pool* pool) {
+    // A mapping would keep every page scanned resident, so unless asked
+    // for the image is read in blocks.
+    input_mode mode = (job.mode == input_mode::automatic) ? input_mode::pread : job.mode;
+    input_source source;
+    std::string error;
+    if(!source.open(input_filepath, mode, error, job.queue_depth)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    crc_engine_set engines(job.models, job.kernel);
+
+    print_columns(job);
+
+    size_t threads = (pool != nullptr) ? pool->size() : 1;
+    std::vector<carve_hit> batch;
+    uint64_t images = 0;
+    auto flush = [&]() {
+        for(carve_hit& hit : batch) {
+            if(pool != nullptr) {
+                carve_hit* h = &hit;
+                pool->submit([&source, &job, &engines, h] { carve_checksum(source, job, engines, *h); });
+            } else {
+                carve_checksum(source, job, engines, hit);
+            }
+        }
+        if(pool != nullptr) {
+            pool->wait();
+        }
+        for(const carve_hit& hit : batch) {
+            if(hit.valid) {
+                print_carve_hit(job, hit);
+                ++images;
+            }
+        }
+        batch.clear();
+    };
+
+    std::vector<uint64_t> candidates;
+    bool last_m = false;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = source.for_each_block(0, source.size(), CARVE_SCAN_BLOCK, [&](const uint8_t* data, size_t len, uint64_t pos) {
+        candidates.clear();
+        // A pair split across two blocks.
+        if(last_m&&(data[0] == 'Z')) {
+            candidates.push_back(pos-1);
+        }
+        mz_scan(data, len, pos, candidates);
+        last_m = (data[len-1] == 'M');
+        for(uint64_t offset : candidates) {
+            carve_hit hit = {};
+            if(carve_candidate(source, offset, hit)) {
+                batch.push_back(hit);
+            }
+        }
+        if(batch.size() >= threads*CARVE_BATCH) {
+            flush();
+        }
+    });
+    flush();
+    if(!ok) {
+        std::cerr << "There was a problem reading the input file!" << std::endl;
+        return 1;
+    }
+    if(job.io_stats) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        std::cerr << "Scanned " << std::dec << source.size() << " bytes in " << seconds << " s, " << (seconds > 0 ? source.size()/seconds/1e6 : 0)
+                  << " MB/s (" << source.reader_name() << ", " << avx2_kernel_name() << ")" << std::endl;
+    }
+    std::cout << "Images: " << std::dec << images << std::endl;
+    return 0;
+}
+
+// Outcome of one file of a batch.
+struct batch_result {
+    std::string out;
+    std::string err;
+    bool ok;
+    bool done;
+};
+
+// Files a worker may run ahead of the oldest unprinted one in input order.
+#define BATCH_WINDOW 1024
+
+static void print_batch_result(const std::string& input_filepath, const batch_result& result) {
+    std::cout << "File: " << input_filepath << std::endl << result.out;
+    if(!result.ok) {
+        std::cout << "Failed" << std::endl;
+    }
+    std::cout << std::flush;
+    std::istringstream lines(result.err);
+    std::string line;
+    while(std::getline(lines, line)) {
+        std::cerr << input_filepath << ": " << line << std::endl;
+    }
+}
+
+// Checksum many files on a pool of workers, one file per worker at a time.
+// A failing file is reported and the batch carries on. Results are printed
+// as they finish, or in input order holding back at most BATCH_WINDOW files.
+int checksum_batch(const std::vector<std::string>& input_filepaths, const checksum_job& job, size_t threads, bool input_order) {
+    std::vector<batch_result> results(input_filepaths.size());
+    std::mutex results_mutex;
+    std::condition_variable result_ready;
+    std::atomic<size_t> next_file(0);
+    size_t next_print = 0;
+    size_t failed = 0;
+
+    thread_pool pool(threads);
+    for(size_t w = 0; w < pool.size(); ++w) {
+        pool.submit([&] {
+            for(size_t i = next_file++; i < input_filepaths.size(); i = next_file++) {
+                if(input_order) {
+                    std::unique_lock<std::mutex> lock(results_mutex);
+                    result_ready.wait(lock, [&] { return i < next_print+BATCH_WINDOW; });
+                }
+                std::ostringstream out, err;
+                bool ok = checksum_file(input_filepaths[i], job, nullptr, 0, out, err);
+
+                std::lock_guard<std::mutex> lock(results_mutex);
+                batch_result& result = results[i];
+                result.ok = ok;
+                failed += ok ? 0 : 1;
+                if(input_order) {
+                    result.out = out.str();
+                    result.err = err.str();
+                    result.done = true;
+                    result_ready.notify_all();
+                } else {
+                    print_batch_result(input_filepaths[i], { out.str(), err.str(), ok, true });
+                }
+            }
+        });
+    }
 
-    return ~crc;
+    if(input_order) {
+        std::unique_lock<std::mutex> lock(results_mutex);
+        while(next_print < input_filepaths.size()) {
+            result_ready.wait(lock, [&] { return results[next_print].done; });
+            print_batch_result(input_filepaths[next_print], results[next_print]);
+            // Release the text, only the status is kept.
+            results[next_print].out.clear();
+            results[next_print].out.shrink_to_fit();
+            results[next_print].err.clear();
+            results[next_print].err.shrink_to_fit();
+            ++next_print;
+            result_ready.notify_all();
+        }
+    }
+    pool.wait();
+
+    std::cerr << "Checked " << std::dec << input_filepaths.size() << " files, " << failed << " failed" << std::endl;
+    return (failed == 0) ? 0 : 1;
+}
+
+// Append the paths listed one per line in a manifest, "-" reading stdin.
+bool read_manifest(const std::string& manifest_path, std::vector<std::string>& input_filepaths) {
+    std::ifstream file;
+    if(manifest_path != "-") {
+        file.open(manifest_path);
+        if(!file) {
+            std::cerr << "Couldn't open the manifest " << manifest_path << "!" << std::endl;
+            return false;
+        }
+    }
+    std::istream& in = (manifest_path == "-") ? std::cin : file;
+    std::string line;
+    while(std::getline(in, line)) {
+        if(!line.empty() && (line.back() == '\r')) {
+            line.pop_back();
+        }
+        if(!line.empty()) {
+            input_filepaths.push_back(line);
+        }
+    }
+    return true;
 }
 
 int main(int argc, char** argv) {
-    std::string input_filepath;
+    std::vector<std::string> input_filepaths;
     ArgParse::ArgParser Parser("msexecrc");
-    Parser.AddArgument("-i", "The input file", &input_filepath, ArgParse::Argument::Required);
+    std::string kernel_name = "auto";
+    std::vector<std::string> generator_names;
+    std::vector<std::string> model_names;
+    bool list_models = false;
+    bool search = false;
+    bool solve = false;
+    std::string search_polys = "1:ffffffff";
+    std::vector<std::string> search_inits;
+    std::vector<std::string> search_xorouts;
+    bool bench = false;
+    int num_threads = 1;
+    bool threads_given = false;
+    unsigned long chunk_size = 0;
+    std::vector<std::string> zero_ranges;
+    std::vector<std::string> exclude_ranges;
+    bool debug = false;
+    std::vector<std::string> manifests;
+    std::string order = "input";
+    std::string io_name = "auto";
+    int queue_depth = 8;
+    std::string patch_name;
+    bool patch_fsync = false;
+    bool patch_atomic = false;
+    bool io_stats = false;
+    std::vector<std::string> edit_texts;
+    std::string old_crc_text;
+    std::string force_text;
+    std::string target_text;
+    bool ne_info = false;
+    bool segments = false;
+    bool segment_resources = false;
+    bool mz_checksum = false;
+    bool fix_mz_checksum = false;
+    bool carve = false;
+    Parser.AddArgument("-i", "The input file, - for stdin. May be repeated to checksum several files", &input_filepaths);
+    Parser.AddArgument("--manifest", "A file listing inputs one per line, - for stdin. May be repeated", &manifests);
+    Parser.AddArgument("--io", "How to read inputs (auto, mmap, pread, uring), auto maps them and falls back to pread", &io_name);
+    Parser.AddArgument("--queue-depth", "Reads kept in flight with --io uring", &queue_depth);
+    Parser.AddArgument("--io-stats", "Report the read bandwidth of each input on stderr", &io_stats);
+    Parser.AddArgument("--order", "Print batch results in input or completion order", &order);
+    Parser.AddArgument("-k/--kernel", "The CRC kernel to use (auto, byte, slice8, slice16, clmul, lanes)", &kernel_name);
+    Parser.AddArgument("-g/--generator", "A reflected generator to try, in hex. May be repeated, replaces the default list", &generator_names);
+    Parser.AddArgument("-m/--model", "A catalogued CRC model to compute, like CRC-16/ARC. May be repeated, replaces the default list, generators and NE-SUM32, unless -g is also given", &model_names);
+    Parser.AddArgument("--list-models", "List the catalogued CRC models and check them", &list_models);
+    Parser.AddArgument("--ne-info", "Print the NE, LE or LX header and tables of the input file", &ne_info);
+    Parser.AddArgument("--segments", "Report the CRCs of each NE segment or LE/LX page and section as well as of the file", &segments);
+    Parser.AddArgument("--resources", "With --segments, also report the CRCs of each resource of an NE binary", &segment_resources);
+    Parser.AddArgument("--carve", "Find the NE, PE, LE and LX images inside a disk or floppy image and checksum each", &carve);
+    Parser.AddArgument("--search", "Search for 32 bit CRC models reproducing the stored NE CRC", &search);
+    Parser.AddArgument("--search-polys", "Range first:last of normal polynomials to search, in hex", &search_polys);
+    Parser.AddArgument("--search-init", "An initial value to search, in hex. May be repeated, defaults to 0 and ffffffff", &search_inits);
+    Parser.AddArgument("--search-xorout", "A final xor to search, in hex. May be repeated, defaults to 0 and ffffffff", &search_xorouts);
+    Parser.AddArgument("--solve", "Solve for the init and xorout of each generator from the stored NE CRCs of two or more inputs", &solve);
+    Parser.AddArgument("--patch", "Write this model's CRC into the NE header, a catalogued 32 bit model or a generator in hex", &patch_name);
+    Parser.AddArgument("--mz-checksum", "Check the MZ header's e_csum over the DOS image", &mz_checksum);
+    Parser.AddArgument("--fix-mz-checksum", "Store the right e_csum when it's off, the other results are of the file as read", &fix_mz_checksum);
+    Parser.AddArgument("--fsync", "Sync patched files to disk", &patch_fsync);
+    Parser.AddArgument("--atomic", "Patch a copy of the file and rename it over the original", &patch_atomic);
+    Parser.AddArgument("--edit", "Update the CRC for bytes changed since it was computed, given as offset:oldhex. May be repeated", &edit_texts);
+    Parser.AddArgument("--old-crc", "The CRC before the edits, in hex, defaults to the stored NE CRC", &old_crc_text);
+    Parser.AddArgument("--force", "Rewrite the 4 bytes at this offset so the CRC of the single -m or -g model comes out as --target", &force_text);
+    Parser.AddArgument("--target", "The CRC to force, in hex, defaults to the stored NE CRC", &target_text);
+    Parser.AddArgument("-j/--threads", "Number of threads for chunked CRC computation, batch workers or the search, 0 uses every hardware thread. The search defaults to all of them",
+                       &num_threads, ArgParse::ArgObject::Optional, &threads_given);
+    Parser.AddArgument("--chunk-size", "Bytes per chunk when threaded, 0 divides the file evenly between the threads", &chunk_size);
+    Parser.AddArgument("--zero", "A range offset:length checksummed as zeros, like the NE CRC field. May be repeated", &zero_ranges);
+    Parser.AddArgument("--exclude", "A range offset:length left out of the checksum. May be repeated", &exclude_ranges);
+    Parser.AddArgument("-d/--debug", "Report each masked byte on stderr", &debug);
+    Parser.AddArgument("--bench", "Report the throughput of each CRC kernel over the input file", &bench);
     if(Parser.ParseArgs(argc, argv) < 0) {
         std::cerr << "There was a problem parsing args" << std::endl;
         return 1;
@@ -73,88 +1953,323 @@ int main(int argc, char** argv) {
     if(Parser.HelpPrinted()) {
         return 0;
     }
-    if(access(input_filepath.c_str(), F_OK) == -1) {
-        std::cerr << "The input file " << input_filepath << " doesn't exist!" << std::endl;
+    crc_kernel kernel;
+    if(!crc_kernel_from_name(kernel_name, kernel)) {
+        std::cerr << "Unknown CRC kernel " << kernel_name << "!" << std::endl;
         return 1;
     }
-    
-    // Open the input file for reading.
-    FILE* infile = fopen(input_filepath.c_str(), "r");
-    if(infile == NULL) {
-        std::cerr << "There was a problem opening the file to be read!" << std::endl;
+
+    if(list_models) {
+        bool all_ok = true;
+        for(const crc_model& model : crc_catalog()) {
+            bool ok = crc_model_verify(model);
+            all_ok = all_ok&&ok;
+            std::cout << model.name << ": " << crc_model_describe(model) << " check=" << std::hex << model.check << std::dec << (ok ? "" : " FAILED");
+            std::string aliases = crc_model_aliases(model);
+            if(!aliases.empty()) {
+                std::cout << " (" << aliases << ")";
+            }
+            std::cout << std::endl;
+        }
+        return all_ok ? 0 : 1;
+    }
+    for(const std::string& manifest : manifests) {
+        if(!read_manifest(manifest, input_filepaths)) {
+            return 1;
+        }
+    }
+    input_mode mode;
+    if(io_name == "auto") {
+        mode = input_mode::automatic;
+    } else if(io_name == "mmap") {
+        mode = input_mode::mmap;
+    } else if(io_name == "pread") {
+        mode = input_mode::pread;
+    } else if(io_name == "uring") {
+        mode = input_mode::uring;
+    } else {
+        std::cerr << "Unknown input mode " << io_name << "!" << std::endl;
+        return 1;
+    }
+    if((queue_depth < 1)||(queue_depth > 4096)) {
+        std::cerr << "The queue depth must be between 1 and 4096!" << std::endl;
+        return 1;
+    }
+    if((order != "input")&&(order != "completion")) {
+        std::cerr << "Unknown order " << order << ", expected input or completion!" << std::endl;
+        return 1;
+    }
+    if(input_filepaths.empty()) {
+        std::cerr << "No input file given!" << std::endl;
+        return 1;
     }
 
-    // Read header info.
-    char buf[BUFFER_SIZE];
-    if(fread(buf, 1, BUFFER_SIZE, infile) == 0) {
-        std::cerr << "There was a problem reading the input file!" << std::endl;
-        fclose(infile);
+    if(ne_info) {
+        if((input_filepaths.size() > 1)||is_stream(input_filepaths[0])) {
+            std::cerr << "--ne-info takes a single seekable input file!" << std::endl;
+            return 1;
+        }
+        return print_ne_info(input_filepaths[0], mode, queue_depth);
+    }
+
+    std::vector<crc_model> named_models;
+    for(const std::string& name : model_names) {
+        crc_model model;
+        if(!crc_model_from_name(name, model)) {
+            std::cerr << "Unknown CRC model " << name << "!" << std::endl;
+            return 1;
+        }
+        named_models.push_back(model);
+    }
+
+    std::vector<uint32_t> generators = {
+        0x04C11DB7, 0xEDB88320, // CRC-32
+        0x1EDC6F41, 0x82F63B78, // CRC-32C
+        0x741B8CD7, 0xEB31D82E, // CRC-32K
+        0x32583499, 0x992C1A4C, // CRC-32K2
+        0x814141AB, 0xD5828281, // CRC-32Q
+    };
+    if(!generator_names.empty()) {
+        generators.clear();
+        for(const std::string& name : generator_names) {
+            uint32_t value;
+            if(!parse_hex32(name, value)) {
+                std::cerr << "Invalid generator " << name << "!" << std::endl;
+                return 1;
+            }
+            generators.push_back(value);
+        }
+    } else if(!named_models.empty()) {
+        generators.clear();
+    }
+
+    if(num_threads < 0) {
+        std::cerr << "The number of threads can't be negative!" << std::endl;
+        return 1;
+    }
+    // The search runs across every core unless told otherwise.
+    if(search&&!threads_given) {
+        num_threads = 0;
+    }
+    size_t threads = (num_threads == 0) ? thread_pool::hardware_threads() : num_threads;
+    // The pool of the modes that split one file, none when single threaded.
+    std::unique_ptr<thread_pool> threaded;
+    auto start_pool = [&]() -> thread_pool* {
+        if(threads > 1) {
+            threaded.reset(new thread_pool(threads));
+        }
+        return threaded.get();
+    };
+
+    // Check the ranges once rather than for every file.
+    mask_list user_mask;
+    if(!build_mask(0, zero_ranges, exclude_ranges, user_mask, std::cerr)) {
         return 1;
     }
 
-    // Check that this is a microsoft binary
-    if((buf[0] != 'M')||(buf[1] != 'Z')) {
-        std::cerr << "This is not a valid microsoft binary!" << std::endl;
-        fclose(infile);
+    if(solve) {
+        return solve_models(input_filepaths, generators, zero_ranges, exclude_ranges, kernel, mode, queue_depth);
+    }
+
+    checksum_job job;
+    job.generators = generators;
+    for(uint32_t generator : generators) {
+        job.models.push_back(crc_sweep_model(generator));
+    }
+    job.models.insert(job.models.end(), named_models.begin(), named_models.end());
+    // The additive checksum rides along with the default sweep, it costs
+    // next to nothing in the same pass.
+    crc_model dword_sum;
+    if(model_names.empty()&&generator_names.empty()&&crc_model_from_name("NE-SUM32", dword_sum)) {
+        job.models.push_back(dword_sum);
+    }
+    job.patch_model = -1;
+    job.patch_fsync = patch_fsync;
+    job.patch_atomic = patch_atomic;
+    if(!patch_name.empty()) {
+        crc_model model;
+        uint32_t generator;
+        if(crc_model_from_name(patch_name, model)) {
+            if(model.width != 32) {
+                std::cerr << "The NE CRC field holds a 32 bit CRC, " << model.name << " is " << std::dec << model.width << " bits!" << std::endl;
+                return 1;
+            }
+        } else if(parse_hex32(patch_name, generator)) {
+            model = crc_sweep_model(generator);
+        } else {
+            std::cerr << "Unknown CRC model " << patch_name << "!" << std::endl;
+            return 1;
+        }
+        // Reuse the model if it's already computed, otherwise add it to the pass.
+        for(size_t m = 0; m < job.models.size(); ++m) {
+            if(crc_model_same_params(job.models[m], model)) {
+                job.patch_model = (int)m;
+                break;
+            }
+        }
+        if(job.patch_model < 0) {
+            job.patch_model = (int)job.models.size();
+            job.models.push_back(model);
+        }
+    }
+    job.kernel = kernel;
+    job.zero_ranges = zero_ranges;
+    job.exclude_ranges = exclude_ranges;
+    job.debug = debug;
+    job.mode = mode;
+    job.queue_depth = queue_depth;
+    job.io_stats = io_stats;
+    job.mz_checksum = mz_checksum||fix_mz_checksum;
+    job.fix_mz_checksum = fix_mz_checksum;
+    if((patch_fsync||patch_atomic)&&(job.patch_model < 0)&&!fix_mz_checksum&&force_text.empty()) {
+        std::cerr << "--fsync and --atomic only apply when patching, fixing or forcing!" << std::endl;
         return 1;
     }
 
-    uint32_t new_header_location = *((uint32_t*)(buf+0x3c));
+    if((input_filepaths.size() > 1)||!manifests.empty()) {
+        if(search||bench) {
+            std::cerr << "Searching and benchmarking take a single input file!" << std::endl;
+            return 1;
+        }
+        if(!edit_texts.empty()||!force_text.empty()||segments||carve) {
+            std::cerr << "Updating, forcing, carving and the segment report take a single input file!" << std::endl;
+            return 1;
+        }
+        return checksum_batch(input_filepaths, job, threads, order == "input");
+    }
+
+    if(carve) {
+        if(search||bench||segments||!edit_texts.empty()||!force_text.empty()||(job.patch_model >= 0)||job.mz_checksum) {
+            std::cerr << "Carving can't be combined with searching, benchmarking, reports, updating, forcing or patching!" << std::endl;
+            return 1;
+        }
+        if(is_stream(input_filepaths[0])) {
+            std::cerr << "Carving needs a seekable input file!" << std::endl;
+            return 1;
+        }
+        return carve_images(input_filepaths[0], job, start_pool());
+    }
 
-    // Seek to new header location file
-    if(fseek(infile, new_header_location, SEEK_SET) != 0) {
-        std::cerr << "Couldn't seek to new header location!" << std::endl;
-        fclose(infile);
+    if(segments) {
+        if(search||bench||!edit_texts.empty()||!force_text.empty()||(job.patch_model >= 0)||job.mz_checksum) {
+            std::cerr << "The segment report can't be combined with searching, benchmarking, updating, forcing, patching or the MZ checksum!" << std::endl;
+            return 1;
+        }
+        if(is_stream(input_filepaths[0])) {
+            std::cerr << "The segment report needs a seekable input file!" << std::endl;
+            return 1;
+        }
+        return segment_report(input_filepaths[0], job, start_pool(), chunk_size, segment_resources);
+    }
+    if(segment_resources) {
+        std::cerr << "--resources only applies with --segments!" << std::endl;
         return 1;
-    } 
-    // Read new buffer data
-    if(fread(buf, 1, BUFFER_SIZE, infile) == 0) {
-        std::cerr << "There was a problem reading the input file!" << std::endl;
-        fclose(infile);
-        return 1;
-    }
-
-    // Check that we have an NE binary
-    if((buf[0] != 'N')||(buf[1] != 'E')) {
-        std::cerr << "This is not an NE binary!" << std::endl;
-        fclose(infile);
-        return 1;
-    }
-
-    uint32_t crc_location = new_header_location+0x8;
-
-    uint32_t gen_1_norm = 0x04C11DB7;
-    uint32_t gen_1_rev = 0xEDB88320;
-    uint32_t gen_2_norm = 0x1EDC6F41;
-    uint32_t gen_2_rev = 0x82F63B78;
-    uint32_t gen_3_norm = 0x741B8CD7;
-    uint32_t gen_3_rev = 0xEB31D82E;
-    uint32_t gen_4_norm = 0x32583499;
-    uint32_t gen_4_rev = 0x992C1A4C;
-    uint32_t gen_5_norm = 0x814141AB;
-    uint32_t gen_5_rev = 0xD5828281;
-
-    uint32_t new_crc_1_norm = rc_crc32(infile, buf, crc_location, gen_1_norm);
-    std::cout << "Generator: " << std::hex << gen_1_norm << " -> " << new_crc_1_norm << std::endl;
-    uint32_t new_crc_1_rev = rc_crc32(infile, buf, crc_location, gen_1_rev);
-    std::cout << "Generator: " << std::hex << gen_1_rev << " -> " << new_crc_1_rev << std::endl;
-    uint32_t new_crc_2_norm = rc_crc32(infile, buf, crc_location, gen_2_norm);
-    std::cout << "Generator: " << std::hex << gen_2_norm << " -> " << new_crc_2_norm << std::endl;
-    uint32_t new_crc_2_rev = rc_crc32(infile, buf, crc_location, gen_2_rev);
-    std::cout << "Generator: " << std::hex << gen_2_rev << " -> " << new_crc_2_rev << std::endl;
-    uint32_t new_crc_3_norm = rc_crc32(infile, buf, crc_location, gen_3_norm);
-    std::cout << "Generator: " << std::hex << gen_3_norm << " -> " << new_crc_3_norm << std::endl;
-    uint32_t new_crc_3_rev = rc_crc32(infile, buf, crc_location, gen_3_rev);
-    std::cout << "Generator: " << std::hex << gen_3_rev << " -> " << new_crc_3_rev << std::endl;
-    uint32_t new_crc_4_norm = rc_crc32(infile, buf, crc_location, gen_4_norm);
-    std::cout << "Generator: " << std::hex << gen_4_norm << " -> " << new_crc_4_norm << std::endl;
-    uint32_t new_crc_4_rev = rc_crc32(infile, buf, crc_location, gen_4_rev);
-    std::cout << "Generator: " << std::hex << gen_4_rev << " -> " << new_crc_4_rev << std::endl;
-    uint32_t new_crc_5_norm = rc_crc32(infile, buf, crc_location, gen_5_norm);
-    std::cout << "Generator: " << std::hex << gen_5_norm << " -> " << new_crc_5_norm << std::endl;
-    uint32_t new_crc_5_rev = rc_crc32(infile, buf, crc_location, gen_5_rev);
-    std::cout << "Generator: " << std::hex << gen_5_rev << " -> " << new_crc_5_rev << std::endl;
-
-    fclose(infile);
-    return 0;
+    }
+    if(!force_text.empty()) {
+        if(search||bench||!edit_texts.empty()||(job.patch_model >= 0)||job.mz_checksum) {
+            std::cerr << "Forcing can't be combined with searching, benchmarking, updating, patching or the MZ checksum!" << std::endl;
+            return 1;
+        }
+        if(is_stream(input_filepaths[0])) {
+            std::cerr << "Forcing needs a seekable input file!" << std::endl;
+            return 1;
+        }
+        if(job.models.size() != 1) {
+            std::cerr << "Forcing needs a single model, give one -m or -g!" << std::endl;
+            return 1;
+        }
+        char* end = nullptr;
+        uint64_t force_location = strtoull(force_text.c_str(), &end, 0);
+        if(*end != '\0') {
+            std::cerr << "Invalid offset " << force_text << "!" << std::endl;
+            return 1;
+        }
+        return force_crc(input_filepaths[0], job, 0, force_location, target_text, start_pool(), chunk_size);
+    }
+    if(!target_text.empty()) {
+        std::cerr << "--target only applies with --force!" << std::endl;
+        return 1;
+    }
+    if(!edit_texts.empty()) {
+        if(search||bench||job.mz_checksum) {
+            std::cerr << "Updating can't be combined with searching, benchmarking or the MZ checksum!" << std::endl;
+            return 1;
+        }
+        if(is_stream(input_filepaths[0])) {
+            std::cerr << "Updating needs a seekable input file!" << std::endl;
+            return 1;
+        }
+        // The patched model if there is one, otherwise the only one given.
+        if((job.patch_model < 0)&&(job.models.size() != 1)) {
+            std::cerr << "Updating needs a single model, give one -m or -g, or --patch!" << std::endl;
+            return 1;
+        }
+        size_t model_index = (job.patch_model >= 0) ? job.patch_model : 0;
+        return update_crc(input_filepaths[0], job, model_index, edit_texts, old_crc_text);
+    }
+    if(!old_crc_text.empty()) {
+        std::cerr << "--old-crc only applies with --edit!" << std::endl;
+        return 1;
+    }
+
+    if((search||bench)&&((job.patch_model >= 0)||job.mz_checksum)) {
+        std::cerr << "Searching and benchmarking can't be combined with patching or the MZ checksum!" << std::endl;
+        return 1;
+    }
+
+    crc_search_space space;
+    if(search) {
+        size_t colon = search_polys.find(':');
+        if((colon == std::string::npos)||!parse_hex32(search_polys.substr(0, colon), space.poly_first)||
+           !parse_hex32(search_polys.substr(colon+1), space.poly_last)) {
+            std::cerr << "Invalid polynomial range " << search_polys << ", expected first:last!" << std::endl;
+            return 1;
+        }
+        if(search_inits.empty()) {
+            search_inits = { "0", "ffffffff" };
+        }
+        if(search_xorouts.empty()) {
+            search_xorouts = { "0", "ffffffff" };
+        }
+        for(const std::string& text : search_inits) {
+            uint32_t value;
+            if(!parse_hex32(text, value)) {
+                std::cerr << "Invalid initial value " << text << "!" << std::endl;
+                return 1;
+            }
+            space.inits.push_back(value);
+        }
+        for(const std::string& text : search_xorouts) {
+            uint32_t value;
+            if(!parse_hex32(text, value)) {
+                std::cerr << "Invalid final xor " << text << "!" << std::endl;
+                return 1;
+            }
+            space.xorouts.push_back(value);
+        }
+    }
+
+    if(!search&&!bench) {
+        return checksum_file(input_filepaths[0], job, start_pool(), chunk_size, std::cout, std::cerr) ? 0 : 1;
+    }
+
+    if(is_stream(input_filepaths[0])) {
+        std::cerr << "Searching and benchmarking need a seekable input file!" << std::endl;
+        return 1;
+    }
+    uint32_t crc_location, stored_crc;
+    input_source source;
+    if(!open_ne_file(input_filepaths[0], mode, queue_depth, source, crc_location, stored_crc, std::cerr)) {
+        return 1;
+    }
+
+    mask_list mask;
+    if(!build_mask(crc_location, zero_ranges, exclude_ranges, mask, std::cerr)) {
+        return 1;
+    }
+
+    if(bench) {
+        return bench_kernels(source, generators);
+    }
+    return search_models(source, mask, stored_crc, space, threads);
 }
@@ -0,0 +1,21 @@
+#include "mz_header.h"
+
+bool mz_parse_header(const uint8_t* data, size_t len, mz_header& header) {
+    if((len < MZ_HEADER_SIZE)||(data[0] != 'M')||(data[1] != 'Z')) {
+        return false;
+    }
+    uint16_t last_page = load_le16(data+MZ_CBLP);
+    uint16_t pages = load_le16(data+MZ_CP);
+    // e_cblp counts the bytes used in the last 512 byte page, 0 when it's full.
+    header.image_size = (uint64_t)pages*512;
+    if((pages != 0)&&(last_page != 0)) {
+        header.image_size -= 512-(last_page & 511);
+    }
+    header.checksum = load_le16(data+MZ_CSUM);
+    return true;
+}
+
+uint16_t mz_checksum_finish(uint64_t sum, uint16_t stored_checksum) {
+    // A plain 16 bit sum, no end around carry, so only the low word counts.
+    return (uint16_t)~(sum-stored_checksum);
+}
@@ -0,0 +1,61 @@
+#include "mz_scan.h"
+#include "cpu_features.h"
+#include <cstring>
+
+static void mz_scan_scalar(const uint8_t* data, size_t len, uint64_t offset, std::vector<uint64_t>& hits) {
+    if(len < 2) {
+        return;
+    }
+    const uint8_t* p = data;
+    const uint8_t* last = data+len-1;
+    while((p = (const uint8_t*)memchr(p, 'M', last-p)) != nullptr) {
+        if(p[1] == 'Z') {
+            hits.push_back(offset+(p-data));
+        }
+        ++p;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Compare 64 positions at a time: the bytes against 'M' and the bytes one
+// further on against 'Z'. Nearly every block of a disk image has neither,
+// so the loop is mostly loads and compares.
+__attribute__((target("avx2")))
+static size_t mz_scan_avx2(const uint8_t* data, size_t len, uint64_t offset, std::vector<uint64_t>& hits) {
+    const __m256i m = _mm256_set1_epi8('M');
+    const __m256i z = _mm256_set1_epi8('Z');
+    size_t i = 0;
+    for(; i+65 <= len; i += 64) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(data+i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(data+i+32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(data+i+1));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(data+i+33));
+        __m256i found0 = _mm256_and_si256(_mm256_cmpeq_epi8(a0, m), _mm256_cmpeq_epi8(b0, z));
+        __m256i found1 = _mm256_and_si256(_mm256_cmpeq_epi8(a1, m), _mm256_cmpeq_epi8(b1, z));
+        if(_mm256_testz_si256(found0, found0)&&_mm256_testz_si256(found1, found1)) {
+            continue;
+        }
+        uint64_t bits = (uint32_t)_mm256_movemask_epi8(found0)|((uint64_t)(uint32_t)_mm256_movemask_epi8(found1) << 32);
+        while(bits != 0) {
+            hits.push_back(offset+i+__builtin_ctzll(bits));
+            bits &= bits-1;
+        }
+    }
+    return i;
+}
+
+void mz_scan(const uint8_t* data, size_t len, uint64_t offset, std::vector<uint64_t>& hits) {
+    size_t done = cpu_has_avx2() ? mz_scan_avx2(data, len, offset, hits) : 0;
+    mz_scan_scalar(data+done, len-done, offset+done, hits);
+}
+
+#else
+
+void mz_scan(const uint8_t* data, size_t len, uint64_t offset, std::vector<uint64_t>& hits) {
+    mz_scan_scalar(data, len, offset, hits);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "ne_image.h"
+#include <algorithm>
+
+bool ne_image::parse(const uint8_t* image, size_t image_size, std::string& error) {
+    data = image;
+    size = image_size;
+    if((size < MZ_HEADER_SIZE)||(data[0] != 'M')||(data[1] != 'Z')) {
+        error = "This is not a valid microsoft binary!";
+        return false;
+    }
+    ne_offset = load_le32(data+MZ_LFANEW);
+    if(!contains(ne_offset, NE_HEADER_SIZE)||(data[ne_offset] != 'N')||(data[ne_offset+1] != 'E')) {
+        error = "This is not an NE binary!";
+        return false;
+    }
+    header = data+ne_offset;
+    return true;
+}
+
+bool ne_image::image_end(uint64_t& end) const {
+    end = (uint64_t)ne_offset+NE_HEADER_SIZE;
+    // The entry table comes last of the tables following the header.
+    end = std::max<uint64_t>(end, table(0x04)+load_le16(header+0x06));
+    uint16_t nonresident_length = load_le16(header+0x20);
+    if(nonresident_length != 0) {
+        end = std::max<uint64_t>(end, (uint64_t)load_le32(header+0x2c)+nonresident_length);
+    }
+    bool ok = for_each_segment([&](const ne_segment& segment) {
+        if(segment.flags & NE_SEGMENT_RELOCINFO) {
+            end = std::max<uint64_t>(end, segment.relocation_offset+(uint64_t)segment.relocation_count*8);
+        } else if(segment.file_offset != 0) {
+            end = std::max<uint64_t>(end, segment.file_offset+segment.file_length);
+        }
+    });
+    // Resource lengths are rounded up to the alignment, as are the files.
+    return for_each_resource([&](const ne_resource& resource) {
+        end = std::max<uint64_t>(end, resource.file_offset+resource.file_length);
+    })&&ok;
+}
@@ -0,0 +1,60 @@
+#include "pe_image.h"
+#include "mz_header.h"
+#include <algorithm>
+
+bool pe_parse_header(const uint8_t* data, size_t len, pe_header& header) {
+    // Everything up to and including Subsystem.
+    if((len < PE_OPTIONAL_OFFSET+70)||(data[0] != 'P')||(data[1] != 'E')||(data[2] != 0)||(data[3] != 0)) {
+        return false;
+    }
+    const uint8_t* file_header = data+PE_SIGNATURE_SIZE;
+    const uint8_t* optional = data+PE_OPTIONAL_OFFSET;
+    uint16_t optional_size = load_le16(file_header+16);
+    uint16_t magic = load_le16(optional);
+    if(((magic != PE_MAGIC_PE32)&&(magic != PE_MAGIC_PE32_PLUS))||(optional_size < 70)) {
+        return false;
+    }
+    header.machine = load_le16(file_header);
+    header.section_count = load_le16(file_header+2);
+    header.pe32_plus = (magic == PE_MAGIC_PE32_PLUS);
+    header.checksum = load_le32(optional+64);
+    header.subsystem = load_le16(optional+68);
+    return true;
+}
+
+bool pe_image_end(const uint8_t* data, size_t len, uint64_t& end) {
+    if(len < MZ_HEADER_SIZE) {
+        return false;
+    }
+    uint64_t pe_offset = load_le32(data+MZ_LFANEW);
+    pe_header header;
+    if((pe_offset > len)||!pe_parse_header(data+pe_offset, len-pe_offset, header)) {
+        return false;
+    }
+    const uint8_t* optional = data+pe_offset+PE_OPTIONAL_OFFSET;
+    uint16_t optional_size = load_le16(data+pe_offset+PE_SIGNATURE_SIZE+16);
+    uint64_t sections = pe_offset+PE_OPTIONAL_OFFSET+optional_size;
+    if(sections+(uint64_t)header.section_count*40 > len) {
+        return false;
+    }
+    // SizeOfHeaders.
+    end = std::max<uint64_t>(sections+(uint64_t)header.section_count*40, load_le32(optional+60));
+    for(unsigned i = 0; i < header.section_count; ++i) {
+        const uint8_t* section = data+sections+i*40;
+        uint32_t raw_size = load_le32(section+16);
+        if(raw_size != 0) {
+            end = std::max<uint64_t>(end, (uint64_t)load_le32(section+20)+raw_size);
+        }
+    }
+    // The certificate table is the one data directory given as a file
+    // offset, and is usually appended after the sections.
+    size_t directories = header.pe32_plus ? 112 : 96;
+    size_t security = directories+4*8;
+    if((optional_size >= security+8)&&(load_le32(optional+directories-4) > 4)) {
+        uint32_t size = load_le32(optional+security+4);
+        if(size != 0) {
+            end = std::max<uint64_t>(end, (uint64_t)load_le32(optional+security)+size);
+        }
+    }
+    return true;
+}
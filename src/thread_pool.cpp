@@ -0,0 +1,69 @@
+#include "thread_pool.h"
+
+size_t thread_pool::hardware_threads() {
+    size_t n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+thread_pool::thread_pool(size_t num_threads) {
+    if(num_threads == 0) {
+        num_threads = hardware_threads();
+    }
+    for(size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back(&thread_pool::run, this);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void thread_pool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    task_ready.notify_one();
+}
+
+void thread_pool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return tasks.empty() && (active == 0); });
+}
+
+bool thread_pool::wait_for(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return all_done.wait_for(lock, timeout, [this] { return tasks.empty() && (active == 0); });
+}
+
+void thread_pool::run() {
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if(tasks.empty()) {
+                // Only reached when stopping.
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            ++active;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active;
+            if(tasks.empty() && (active == 0)) {
+                all_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,265 @@
+#include "uring_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define MSEXECRC_HAVE_URING 1
+#endif
+
+uring_reader::~uring_reader() {
+    close();
+}
+
+#ifdef MSEXECRC_HAVE_URING
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+bool uring_reader::init(unsigned depth, size_t size) {
+    close();
+    if(broken) {
+        return false;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(depth, &params);
+    if(fd < 0) {
+        return false;
+    }
+    ring_fd = fd;
+    queue_depth = depth;
+    block_size = size;
+
+    sq_ring_size = params.sq_off.array+params.sq_entries*sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+    sqe_size = params.sq_entries*sizeof(struct io_uring_sqe);
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq_ring = mmap(nullptr, cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqe_memory = mmap(nullptr, sqe_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+    if((sq_ring == MAP_FAILED)||(cq_ring == MAP_FAILED)||(sqe_memory == MAP_FAILED)) {
+        sq_ring = (sq_ring == MAP_FAILED) ? nullptr : sq_ring;
+        cq_ring = (cq_ring == MAP_FAILED) ? nullptr : cq_ring;
+        sqe_memory = (sqe_memory == MAP_FAILED) ? nullptr : sqe_memory;
+        close();
+        return false;
+    }
+    uint8_t* sq = (uint8_t*)sq_ring;
+    uint8_t* cq = (uint8_t*)cq_ring;
+    sq_head = (unsigned*)(sq+params.sq_off.head);
+    sq_tail = (unsigned*)(sq+params.sq_off.tail);
+    sq_mask = (unsigned*)(sq+params.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq+params.sq_off.array);
+    cq_head = (unsigned*)(cq+params.cq_off.head);
+    cq_tail = (unsigned*)(cq+params.cq_off.tail);
+    cq_mask = (unsigned*)(cq+params.cq_off.ring_mask);
+    cqes = cq+params.cq_off.cqes;
+
+    // Page aligned buffers, registered so the kernel pins them once.
+    std::vector<struct iovec> iovecs;
+    for(unsigned i = 0; i < depth; ++i) {
+        void* buf = nullptr;
+        if(posix_memalign(&buf, 4096, size) != 0) {
+            close();
+            return false;
+        }
+        buffers.push_back((uint8_t*)buf);
+        iovecs.push_back({ buf, size });
+    }
+    // Registration can fail on a low RLIMIT_MEMLOCK, plain reads still work.
+    fixed_buffers = (sys_io_uring_register(fd, IORING_REGISTER_BUFFERS, iovecs.data(), depth) == 0);
+    slots.resize(depth);
+    return true;
+}
+
+void uring_reader::close() {
+    if(sqe_memory != nullptr) {
+        munmap(sqe_memory, sqe_size);
+    }
+    if(cq_ring != nullptr) {
+        munmap(cq_ring, cq_ring_size);
+    }
+    if(sq_ring != nullptr) {
+        munmap(sq_ring, sq_ring_size);
+    }
+    sq_ring = cq_ring = sqe_memory = nullptr;
+    if(ring_fd >= 0) {
+        ::close(ring_fd);
+        ring_fd = -1;
+    }
+    for(uint8_t* buf : buffers) {
+        free(buf);
+    }
+    buffers.clear();
+    slots.clear();
+    unsubmitted = 0;
+}
+
+// Queue the unread part of a slot's block.
+void uring_reader::queue_read(int fd, unsigned index) {
+    slot& s = slots[index];
+    unsigned tail = *sq_tail;
+    unsigned pos = tail & *sq_mask;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqe_memory+pos;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = s.offset+s.filled;
+    sqe->addr = (uint64_t)(uintptr_t)(buffers[index]+s.filled);
+    sqe->len = (uint32_t)(s.len-s.filled);
+    sqe->buf_index = fixed_buffers ? index : 0;
+    sqe->user_data = index;
+    sq_array[pos] = pos;
+    // Publish the entry before the tail.
+    __atomic_store_n(sq_tail, tail+1, __ATOMIC_RELEASE);
+    ++unsubmitted;
+}
+
+// io_uring_enter returns how many entries it took, which can be fewer than
+// asked for, and then it doesn't wait. Go round until they're all in.
+bool uring_reader::submit(bool wait) {
+    while(true) {
+        int ret = sys_io_uring_enter(ring_fd, unsubmitted, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+        if(ret < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if(unsubmitted == 0) {
+            return true;
+        }
+        if(ret == 0) {
+            return false;
+        }
+        unsubmitted -= std::min<unsigned>(unsubmitted, (unsigned)ret);
+        if(unsubmitted == 0) {
+            return true;
+        }
+    }
+}
+
+void uring_reader::abandon() {
+    close();
+    broken = true;
+}
+
+bool uring_reader::read(int fd, uint64_t offset, uint64_t len, const block_fn& fn) {
+    uint64_t end = offset+len;
+    uint64_t blocks = (len+block_size-1)/block_size;
+    uint64_t next_queue = 0;
+    unsigned in_flight = 0;
+    bool ok = true;
+
+    auto start_block = [&](uint64_t block) {
+        unsigned index = (unsigned)(block%queue_depth);
+        slot& s = slots[index];
+        s.offset = offset+block*block_size;
+        s.len = (size_t)std::min<uint64_t>(block_size, end-s.offset);
+        s.filled = 0;
+        s.done = false;
+        queue_read(fd, index);
+        ++in_flight;
+    };
+
+    while((next_queue < blocks)&&(next_queue < queue_depth)) {
+        start_block(next_queue++);
+    }
+
+    // Blocks are handed out in order, block k lives in slot k % depth.
+    for(uint64_t next_deliver = 0; ok && (next_deliver < blocks);) {
+        slot& want = slots[next_deliver%queue_depth];
+        if(want.done) {
+            fn(buffers[next_deliver%queue_depth], want.len, want.offset);
+            ++next_deliver;
+            if(next_queue < blocks) {
+                // Put the refill in flight now, so it overlaps the blocks
+                // still to be handed out rather than waiting for the next
+                // slot that isn't done.
+                start_block(next_queue++);
+                if(!submit(false)) {
+                    ok = false;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if(!submit(true)) {
+            ok = false;
+            break;
+        }
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; ++head) {
+            struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes+(head & *cq_mask);
+            unsigned index = (unsigned)cqe->user_data;
+            slot& s = slots[index];
+            --in_flight;
+            if((cqe->res == -EINTR)||(cqe->res == -EAGAIN)) {
+                queue_read(fd, index);
+                ++in_flight;
+            } else if(cqe->res <= 0) {
+                // An error, or the file ended early.
+                ok = false;
+            } else {
+                s.filled += cqe->res;
+                if(s.filled < s.len) {
+                    queue_read(fd, index);
+                    ++in_flight;
+                } else {
+                    s.done = true;
+                }
+            }
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Drain reads still in flight so the buffers can be reused. If the
+    // ring can't be waited on, the kernel mustn't go on writing into
+    // buffers this thread hands out again.
+    while(in_flight > 0) {
+        if(!submit(true)) {
+            abandon();
+            return false;
+        }
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; ++head) {
+            --in_flight;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    return ok;
+}
+
+#else
+
+bool uring_reader::init(unsigned, size_t) {
+    return false;
+}
+
+void uring_reader::close() {
+}
+
+bool uring_reader::read(int, uint64_t, uint64_t, const block_fn&) {
+    return false;
+}
+
+#endif